@@ -37,6 +37,9 @@ namespace game_io_test
     public:
         img::GraySubView mask;
         img::SubView out;
+
+        // run length copy of the whole mask image, or null
+        img::MaskRLE const* rle;
     };
 
     using ControllerMaskViewMap = ControllerDef<MaskViewMap>;
@@ -82,13 +85,20 @@ namespace game_io_test
     }
 
 
+    static img::MaskRLE const* rle_or_null(img::MaskRLE const& rle)
+    {
+        return rle.runs.ok ? &rle : nullptr;
+    }
+
+
     template <class M, class MV>
-    static void set_map_masks(M const& m, MV& mv)
+    static void set_map_masks(M const& m, img::MaskRLE const& rle, MV& mv)
     {
         static_assert(M::count == MV::count);
         for (u32 i = 0; i < mv.count; i++)
         {
             mv.list[i].mask = m.list[i];
+            mv.list[i].rle = rle_or_null(rle);
         }
     }
 
@@ -108,7 +118,9 @@ namespace game_io_test
     {
         auto sub_full = img::sub_view(view, img::make_rect(view.width, view.height));
         mv.stick_left.mask = sub_full;
+        mv.stick_left.rle = nullptr;
         mv.stick_right.mask = sub_full;
+        mv.stick_right.rle = nullptr;
     }
     
 
@@ -143,24 +155,28 @@ namespace game_io_test
 
         mv.controller1.mask = sub_full(c_mask);
         mv.controller1.out = c_out1;
+        mv.controller1.rle = rle_or_null(masks.controller_rle);
 
         mv.controller2.mask = sub_full(c_mask);
         mv.controller2.out = c_out2;
+        mv.controller2.rle = rle_or_null(masks.controller_rle);
 
         mv.keyboard.mask = sub_full(k_mask);
         mv.keyboard.out = k_out;
+        mv.keyboard.rle = rle_or_null(masks.keyboard_rle);
 
         mv.mouse.mask = sub_full(m_mask);
         mv.mouse.out = m_out;
+        mv.mouse.rle = rle_or_null(masks.mouse_rle);
 
         auto creg = assets::controller::get_region_rects();
         auto kreg = assets::keyboard::get_region_rects();
         auto mreg = assets::mouse::get_region_rects();
 
-        set_map_masks(masks.controller, mv.controller1_inputs);
-        set_map_masks(masks.controller, mv.controller2_inputs);
-        set_map_masks(masks.keyboard, mv.keyboard_inputs);
-        set_map_masks(masks.mouse, mv.mouse_inputs);
+        set_map_masks(masks.controller, masks.controller_rle, mv.controller1_inputs);
+        set_map_masks(masks.controller, masks.controller_rle, mv.controller2_inputs);
+        set_map_masks(masks.keyboard, masks.keyboard_rle, mv.keyboard_inputs);
+        set_map_masks(masks.mouse, masks.mouse_rle, mv.mouse_inputs);
 
         set_map_out(c_out1, creg, mv.controller1_inputs);
         set_map_out(c_out2, creg, mv.controller2_inputs);
@@ -391,6 +407,61 @@ namespace game_io_test
 }
 
 
+/* rect */
+
+namespace game_io_test
+{
+    static Rect2Du32 to_rect(img::SubView const& view)
+    {
+        return img::make_rect(view.x_begin, view.y_begin, view.width, view.height);
+    }
+
+
+    static bool is_empty(Rect2Du32 const& r)
+    {
+        return r.x_begin >= r.x_end || r.y_begin >= r.y_end;
+    }
+
+
+    static Rect2Du32 intersect(Rect2Du32 const& a, Rect2Du32 const& b)
+    {
+        Rect2Du32 r{};
+        r.x_begin = num::max(a.x_begin, b.x_begin);
+        r.x_end = num::min(a.x_end, b.x_end);
+        r.y_begin = num::max(a.y_begin, b.y_begin);
+        r.y_end = num::min(a.y_end, b.y_end);
+
+        return r;
+    }
+
+
+    static Rect2Du32 merge(Rect2Du32 const& a, Rect2Du32 const& b)
+    {
+        Rect2Du32 r{};
+        r.x_begin = num::min(a.x_begin, b.x_begin);
+        r.x_end = num::max(a.x_end, b.x_end);
+        r.y_begin = num::min(a.y_begin, b.y_begin);
+        r.y_end = num::max(a.y_end, b.y_end);
+
+        return r;
+    }
+
+
+    static bool contains(Rect2Du32 const& outer, Rect2Du32 const& inner)
+    {
+        return 
+            inner.x_begin >= outer.x_begin && inner.x_end <= outer.x_end &&
+            inner.y_begin >= outer.y_begin && inner.y_end <= outer.y_end;
+    }
+
+
+    static Rect2Du32 offset_rect(Rect2Du32 const& r, Rect2Du32 const& origin)
+    {
+        return img::make_rect(r.x_begin - origin.x_begin, r.y_begin - origin.y_begin, r.x_end - r.x_begin, r.y_end - r.y_begin);
+    }
+}
+
+
 /* draw */
 
 namespace game_io_test
@@ -426,26 +497,74 @@ namespace game_io_test
     }
 
 
+    static p32 mask_color_on(u8 m)
+    {
+        return m == 1 ? COLOR_BLACK : COLOR_ON;
+    }
+
+
+    static p32 mask_color_off(u8 m)
+    {
+        return m == 1 ? COLOR_BLACK : COLOR_OFF;
+    }
+
+
     static void draw(MaskViewMap const& view, b8 is_on)
     {
-        auto f = is_on ? mask_set_on : mask_set_off;
+        if (view.rle)
+        {
+            auto& m = view.mask;
+            auto range = img::make_rect(m.x_begin, m.y_begin, m.width, m.height);
+
+            img::transform(*view.rle, range, view.out, is_on ? mask_color_on : mask_color_off);
+        }
+        else if (is_on)
+        {
+            img::transform(view.mask, view.out, mask_set_on);
+        }
+        else
+        {
+            img::transform(view.mask, view.out, mask_set_off);
+        }
+    }
+
+
+    static void draw(MaskViewMap const& view, b8 is_on, Rect2Du32 const& clip)
+    {
+        auto out = to_rect(view.out);
+        auto r = intersect(out, clip);
+        if (is_empty(r))
+        {
+            return;
+        }
+
+        r = offset_rect(r, out);
+
+        MaskViewMap clipped{};
+        clipped.mask = img::sub_view(view.mask, r);
+        clipped.out = img::sub_view(view.out, r);
+        clipped.rle = view.rle;
 
-        img::transform(view.mask, view.out, f);
+        draw(clipped, is_on);
     }
 
 
-    static void draw_thumstick_directions(ControllerStickMaskViewMap const& m, ControllerStickRotation const& rot)
+    static void draw_thumstick_directions(ControllerStickMaskViewMap const& m, ControllerStickRotation const& rot, Rect2Du32 const& clip)
     {
-        auto const is_on = [](Vec2Df32 v) { return num::abs((v.x * v.x + v.y * v.y) - 1.0f) < 0.001f; };
+        // dirty rects always contain the whole stick region
+        auto const is_on = [&](img::SubView const& out, Vec2Df32 v) 
+        { 
+            return !is_empty(intersect(to_rect(out), clip)) && num::abs((v.x * v.x + v.y * v.y) - 1.0f) < 0.001f; 
+        };
 
         auto const f = [](u8 s) { return s ? COLOR_BLACK : COLOR_TRANSPARENT; };
 
-        if (is_on(rot.stick_left))
+        if (is_on(m.stick_left.out, rot.stick_left))
         {
             img::rotate_blend_transform(m.stick_left.mask, m.stick_left.out, rot.stick_left, f);
         }
 
-        if (is_on(rot.stick_right))
+        if (is_on(m.stick_right.out, rot.stick_right))
         {
             img::rotate_blend_transform(m.stick_right.mask, m.stick_right.out, rot.stick_right, f);
         }        
@@ -453,52 +572,190 @@ namespace game_io_test
     }
 
 
-    static void draw_mouse_coords(MouseMaskViewMap const& mv, Vec2Di32 pos)
+    static void draw_mouse_coords(MouseMaskViewMap const& mv, Vec2Di32 pos, Rect2Du32 const& clip)
     {
+        // dirty rects always contain the whole text region
+        auto const in_clip = [&](img::SubView const& out) { return !is_empty(intersect(to_rect(out), clip)); };
+
         auto font = ascii::Font::Joystick8;
         auto color = COLOR_BLACK;
 
         char buffer[16];
 
         auto out = mv.pos_x.out;
-        img::fill(out, COLOR_BACKGROUND);
-        stb::qsnprintf(buffer, 16, "X: %d", pos.x);
-        ascii::render_text(buffer, out, font, color);
+        if (in_clip(out))
+        {
+            img::fill(out, COLOR_BACKGROUND);
+            stb::qsnprintf(buffer, 16, "X: %d", pos.x);
+            ascii::render_text(buffer, out, font, color);
+        }
 
         out = mv.pos_y.out;
-        img::fill(out, COLOR_BACKGROUND);
-        stb::qsnprintf(buffer, 16, "Y: %d", pos.y);
-        ascii::render_text(buffer, out, font, color);
+        if (in_clip(out))
+        {
+            img::fill(out, COLOR_BACKGROUND);
+            stb::qsnprintf(buffer, 16, "Y: %d", pos.y);
+            ascii::render_text(buffer, out, font, color);
+        }
+    }
+
+
+    template <class M, class I>
+    static void draw_masks(M const& m, I const& in, Rect2Du32 const& clip)
+    {
+        static_assert(M::count == I::count);
+        for (u32 i = 0; i < m.count; i++)
+        {
+            draw(m.list[i], in.list[i], clip);
+        }
+    }
+
+
+    static void draw(img::ImageView const& out, MaskViewMapList const& mv, InputList const& input, Rect2Du32 const& clip)
+    {
+        img::fill(img::sub_view(out, clip), COLOR_BACKGROUND);
+
+        draw(mv.controller1, 0, clip);
+        draw(mv.controller2, 0, clip);
+        draw(mv.keyboard, 0, clip);
+        draw(mv.mouse, 0, clip);
+
+        draw_masks(mv.controller1_inputs, input.controller1, clip);
+        draw_masks(mv.controller2_inputs, input.controller2, clip);
+        draw_masks(mv.keyboard_inputs, input.keyboard, clip);
+        draw_masks(mv.mouse_inputs, input.mouse, clip);
+
+        draw_thumstick_directions(mv.controller1_thumbsticks, input.sticks1, clip);
+        draw_thumstick_directions(mv.controller2_thumbsticks, input.sticks2, clip);
+
+        draw_mouse_coords(mv.mouse_inputs, input.mouse_pos, clip);
+    }
+}
+
+
+/* dirty rects */
+
+namespace game_io_test
+{
+    static void clear_dirty(DirtyRects& dirty)
+    {
+        dirty.count = 0;
+    }
+
+
+    static void add_dirty(DirtyRects& dirty, Rect2Du32 const& r)
+    {
+        if (is_empty(r))
+        {
+            return;
+        }
+
+        if (dirty.count < dirty.capacity)
+        {
+            dirty.list[dirty.count++] = r;
+            return;
+        }
+
+        // out of space, collapse to one rect
+        auto all = r;
+        for (u32 i = 0; i < dirty.count; i++)
+        {
+            all = merge(all, dirty.list[i]);
+        }
+
+        dirty.list[0] = all;
+        dirty.count = 1;
     }
 
 
     template <class M, class I>
-    static void draw_masks(M const& m, I const& in)
+    static void add_changed(DirtyRects& dirty, M const& m, I const& curr, I const& prev)
     {
         static_assert(M::count == I::count);
         for (u32 i = 0; i < m.count; i++)
         {
-            draw(m.list[i], in.list[i]);
+            if (curr.list[i] != prev.list[i])
+            {
+                add_dirty(dirty, to_rect(m.list[i].out));
+            }
         }
     }
 
 
-    static void draw(MaskViewMapList const& mv, InputList const& input)
+    static void add_changed(DirtyRects& dirty, ControllerStickMaskViewMap const& m, ControllerStickRotation const& curr, ControllerStickRotation const& prev)
     {
-        draw(mv.controller1, 0);
-        draw(mv.controller2, 0);
-        draw(mv.keyboard, 0);
-        draw(mv.mouse, 0);
+        auto const changed = [](Vec2Df32 a, Vec2Df32 b) { return a.x != b.x || a.y != b.y; };
 
-        draw_masks(mv.controller1_inputs, input.controller1);
-        draw_masks(mv.controller2_inputs, input.controller2);
-        draw_masks(mv.keyboard_inputs, input.keyboard);
-        draw_masks(mv.mouse_inputs, input.mouse);
+        if (changed(curr.stick_left, prev.stick_left))
+        {
+            add_dirty(dirty, to_rect(m.stick_left.out));
+        }
+
+        if (changed(curr.stick_right, prev.stick_right))
+        {
+            add_dirty(dirty, to_rect(m.stick_right.out));
+        }
+    }
 
-        draw_thumstick_directions(mv.controller1_thumbsticks, input.sticks1);
-        draw_thumstick_directions(mv.controller2_thumbsticks, input.sticks2);
 
-        draw_mouse_coords(mv.mouse_inputs, input.mouse_pos);
+    static void add_changed(DirtyRects& dirty, MouseMaskViewMap const& m, Vec2Di32 curr, Vec2Di32 prev)
+    {
+        if (curr.x != prev.x || curr.y != prev.y)
+        {
+            add_dirty(dirty, to_rect(m.pos_x.out));
+            add_dirty(dirty, to_rect(m.pos_y.out));
+        }
+    }
+
+
+    static void expand_dirty(DirtyRects& dirty, MaskViewMapList const& mv)
+    {
+        // regions that can only be redrawn whole
+        Rect2Du32 const regions[] = {
+            to_rect(mv.controller1_thumbsticks.stick_left.out),
+            to_rect(mv.controller1_thumbsticks.stick_right.out),
+            to_rect(mv.controller2_thumbsticks.stick_left.out),
+            to_rect(mv.controller2_thumbsticks.stick_right.out),
+            to_rect(mv.mouse_inputs.pos_x.out),
+            to_rect(mv.mouse_inputs.pos_y.out),
+        };
+
+        for (u32 i = 0; i < dirty.count; i++)
+        {
+            auto& r = dirty.list[i];
+
+            bool expanded = true;
+            while (expanded)
+            {
+                expanded = false;
+                for (auto const& reg : regions)
+                {
+                    if (!is_empty(intersect(r, reg)) && !contains(r, reg))
+                    {
+                        r = merge(r, reg);
+                        expanded = true;
+                    }
+                }
+            }
+        }
+    }
+
+
+    static void find_dirty(DirtyRects& dirty, MaskViewMapList const& mv, InputList const& curr, InputList const& prev)
+    {
+        clear_dirty(dirty);
+
+        add_changed(dirty, mv.controller1_inputs, curr.controller1, prev.controller1);
+        add_changed(dirty, mv.controller2_inputs, curr.controller2, prev.controller2);
+        add_changed(dirty, mv.keyboard_inputs, curr.keyboard, prev.keyboard);
+        add_changed(dirty, mv.mouse_inputs, curr.mouse, prev.mouse);
+
+        add_changed(dirty, mv.controller1_thumbsticks, curr.sticks1, prev.sticks1);
+        add_changed(dirty, mv.controller2_thumbsticks, curr.sticks2, prev.sticks2);
+
+        add_changed(dirty, mv.mouse_inputs, curr.mouse_pos, prev.mouse_pos);
+
+        expand_dirty(dirty, mv);
     }
 }
 
@@ -518,12 +775,21 @@ namespace game_io_test
 
         MaskViewMapList mask_views;
         InputList inputs;
+        InputList prev_inputs;
+
+        DirtyRects dirty;
+        b8 redraw_all;
 
         img::ImageView out_src;
         img::SubView out_dst;
 
         u32 out_scale = 1;
 
+        // out_src is the screen, nothing to scale
+        b8 out_direct;
+
+        img::Execution execution;
+
         img::Buffer32 buffer32;
         img::Buffer8 buffer8;
     };
@@ -539,6 +805,7 @@ namespace game_io_test
     {
         auto& data = get_data(state);
 
+        assets::destroy_draw_mask_data(data.masks);
         mb::destroy_buffer(data.buffer32);
         mb::destroy_buffer(data.buffer8);
         mem::free(state.data);
@@ -594,6 +861,11 @@ namespace game_io_test
         }
 
         clear_input_list(data.inputs);
+        clear_dirty(data.dirty);
+        data.redraw_all = 1;
+
+        data.execution.n_threads = img::hardware_threads();
+        data.execution.min_rows = 64;
 
         assets::destroy_asset_memory(am);
 
@@ -607,6 +879,7 @@ namespace game_io_test
     static void reset_data(StateData& data)
     {
         clear_input_list(data.inputs);
+        data.redraw_all = 1;
     }
 }
 
@@ -669,6 +942,12 @@ namespace game_io_test
         data.out_dst = img::sub_view(screen, r);
         data.out_scale = scale;
 
+        data.out_direct = scale == 1 && screen.width == dim.x && screen.height == dim.y;
+        data.out_src = data.out_direct ? screen : img::make_view(dim.x, dim.y, data.buffer32);
+        set_mask_views(data.masks, data.out_src, data.mask_views);
+
+        data.redraw_all = 1;
+
         return true;
     }
 
@@ -683,10 +962,42 @@ namespace game_io_test
         update_sound(input, data.sound_list);
         update_music(input, data.music_list);
 
-        img::fill(data.out_src, COLOR_BACKGROUND);
+        img::ExecutionScope exe(data.execution);
+
+        find_dirty(data.dirty, data.mask_views, data.inputs, data.prev_inputs);
+        data.prev_inputs = data.inputs;
+
+        clear_dirty(state.screen_dirty);
+
+        if (data.redraw_all)
+        {
+            draw(data.out_src, data.mask_views, data.inputs, img::make_rect(data.out_src.width, data.out_src.height));
+            if (!data.out_direct)
+            {
+                img::scale_up(data.out_src, data.out_dst, data.out_scale);
+            }
 
-        draw(data.mask_views, data.inputs);
-        img::scale_up(data.out_src, data.out_dst, data.out_scale);
+            add_dirty(state.screen_dirty, img::make_rect(state.screen.width, state.screen.height));
+            data.redraw_all = 0;
+            return;
+        }
+
+        auto scale = data.out_scale;
+        auto dst = to_rect(data.out_dst);
+
+        for (u32 i = 0; i < data.dirty.count; i++)
+        {
+            auto r = data.dirty.list[i];
+            draw(data.out_src, data.mask_views, data.inputs, r);
+
+            auto r_dst = img::make_rect(r.x_begin * scale, r.y_begin * scale, (r.x_end - r.x_begin) * scale, (r.y_end - r.y_begin) * scale);
+            if (!data.out_direct)
+            {
+                img::scale_up(img::sub_view(data.out_src, r), img::sub_view(data.out_dst, r_dst), scale);
+            }
+
+            add_dirty(state.screen_dirty, img::make_rect(dst.x_begin + r_dst.x_begin, dst.y_begin + r_dst.y_begin, r_dst.x_end - r_dst.x_begin, r_dst.y_end - r_dst.y_begin));
+        }
     }
 
 
@@ -16,11 +16,24 @@ namespace game_io_test
     class StateData;
 
 
+    class DirtyRects
+    {
+    public:
+        static constexpr u32 capacity = 64;
+
+        Rect2Du32 list[capacity];
+        u32 count = 0;
+    };
+
+
     class AppState
     {
     public:
         img::ImageView screen;
 
+        // screen regions written by the last update
+        DirtyRects screen_dirty;
+
         StateData* data = nullptr;        
     };
 
@@ -46,10 +46,13 @@ namespace assets
 
         struct
         {
-            img::Image controller;
-            img::Image keyboard;
-            img::Image mouse;
-            img::Image arrow;
+            // all masks are decoded into one atlas
+            img::Image atlas;
+
+            img::SubView controller;
+            img::SubView keyboard;
+            img::SubView mouse;
+            img::SubView arrow;
 
         } image;
 
@@ -79,19 +82,30 @@ namespace assets
     {
         // -03 optimizer bug?
     #if 0
-        img::destroy_image(memory.image.controller);
-        img::destroy_image(memory.image.keyboard);
-        img::destroy_image(memory.image.mouse);
-        img::destroy_image(memory.image.arrow);
+        img::destroy_image(memory.image.atlas);
     #endif
 
         mb::destroy_buffer(memory.buffer);
     }
 
 
+    // decodes an atlas written by assets_to_bin and checks it against its rect table
+    template <class RECTS>
+    static bool read_atlas(ByteView const& bytes, RECTS const& rects, img::Image& atlas)
+    {
+        if (!img::read_image_from_memory(bytes, atlas))
+        {
+            return false;
+        }
+
+        return atlas.width == rects.width && atlas.height == rects.height;
+    }
+
+
     static bool load_asset_memory(AssetMemory& memory)
     {
     #include "../res/asset_sizes.cpp"
+    #include "../res/asset_rects.cpp"
 
         auto buffer = fs::read_bytes(BIN_DATA_PATH);
         if (!buffer.ok)
@@ -106,35 +120,19 @@ namespace assets
 
         auto const make_view = [&](auto const& s) { return span::make_view(buffer.data_ + s.offset, s.size); };
 
-        auto const read_image = [&](auto const& s, auto& im)
-        {
-            return img::read_image_from_memory(make_view(s), im);
-        };
+        auto& rects = asset_rects.masks;
 
-        bool res = false;
-        res = read_image(asset_sizes.masks.controller, memory.image.controller);
-        if (!res)
+        if (!read_atlas(make_view(asset_sizes.masks.atlas), rects, memory.image.atlas))
         {
             return false;
         }
 
-        res = read_image(asset_sizes.masks.keyboard, memory.image.keyboard);
-        if (!res)
-        {
-            return false;
-        }
+        auto atlas = img::make_view(memory.image.atlas);
 
-        res = read_image(asset_sizes.masks.mouse, memory.image.mouse);
-        if (!res)
-        {
-            return false;
-        }
-
-        res = read_image(asset_sizes.masks.arrow, memory.image.arrow);
-        if (!res)
-        {
-            return false;
-        }
+        memory.image.controller = img::sub_view(atlas, rects.controller);
+        memory.image.keyboard = img::sub_view(atlas, rects.keyboard);
+        memory.image.mouse = img::sub_view(atlas, rects.mouse);
+        memory.image.arrow = img::sub_view(atlas, rects.arrow);
 
         memory.music.A = make_view(asset_sizes.music.game_00);
         memory.music.B = make_view(asset_sizes.music.game_01);
@@ -176,13 +174,12 @@ namespace assets
     }
 
 
-    static img::GrayView make_mask(img::Image const& img32, img::Buffer8& buffer)
+    static img::GrayView make_mask(img::SubView const& view, img::Buffer8& buffer)
     {
-        auto w = img32.width;
-        auto h = img32.height;
+        auto w = view.width;
+        auto h = view.height;
 
         auto mask = img::make_view(w, h, buffer);
-        auto view = img::make_view(img32);
 
         img::transform(view, mask, to_u8_mask);
 
@@ -420,6 +417,10 @@ namespace assets
         img::GrayView mouse_view;
 
         img::GrayView arrow_view;
+
+        img::MaskRLE controller_rle;
+        img::MaskRLE keyboard_rle;
+        img::MaskRLE mouse_rle;
     };
 
 
@@ -472,9 +473,22 @@ namespace assets
         data.mouse_view = mmv;
         data.arrow_view = amv;
 
+        // byte masks are used for any that fail
+        img::create_mask_rle(data.controller_rle, cmv);
+        img::create_mask_rle(data.keyboard_rle, kmv);
+        img::create_mask_rle(data.mouse_rle, mmv);
+
         return data;
     }
 
+
+    static void destroy_draw_mask_data(DrawMaskData& data)
+    {
+        img::destroy_mask_rle(data.controller_rle);
+        img::destroy_mask_rle(data.keyboard_rle);
+        img::destroy_mask_rle(data.mouse_rle);
+    }
+
 }
 
 
@@ -81,7 +81,12 @@ bool create_window(Vec2Du32 game_dims)
         game_dims.y > WINDOW_HEIGHT ? game_dims.y : WINDOW_HEIGHT
     };
 
-    if (!window::create(mn::window, game::APP_TITLE, window_dims, game_dims, icon))
+    // the game draws at native size, the window scales it on render
+    auto scale_w = window_dims.x / game_dims.x;
+    auto scale_h = window_dims.y / game_dims.y;
+    auto pixel_scale = scale_w < scale_h ? scale_w : scale_h;
+
+    if (!window::create(mn::window, game::APP_TITLE, window_dims, game_dims, pixel_scale, icon))
     {
         return false;
     }
@@ -184,7 +189,9 @@ static void main_loop()
 
         game::update(mn::app_state, input);
 
-        window::render(mn::window, input.window_size_changed);
+        // only regions drawn this frame are uploaded
+        auto& dirty = mn::app_state.screen_dirty;
+        window::render(mn::window, dirty.list, dirty.count, input.window_size_changed);
 
         mn::inputs.swap();
         cap_framerate(sw, TARGET_NS_PER_FRAME);
@@ -0,0 +1,23 @@
+// asset_rects.cpp
+
+const struct {
+
+    struct {
+        unsigned width; unsigned height;
+        Rect2Du32 keyboard;
+        Rect2Du32 controller;
+        Rect2Du32 mouse;
+        Rect2Du32 arrow;
+    } masks;
+
+}
+asset_rects = 
+{
+    {
+        512, 184,
+        { 0, 272, 0, 92 },
+        { 272, 464, 0, 92 },
+        { 0, 80, 92, 184 },
+        { 464, 489, 0, 25 },
+    },
+};
@@ -14,11 +14,11 @@ int main()
 
     a2b::create(af, DST_ROOT, "io_test_data");
     
-    a2b::append_file_dir(af, root / "masks");
+    a2b::append_atlas_dir(af, root / "masks");
     a2b::append_file_dir(af, root / "music");
     a2b::append_file_dir(af, root / "sfx");
 
-    a2b::save_and_close(af, "asset_sizes");
+    a2b::save_and_close(af, "asset_sizes", "asset_rects");
 }
 
 
@@ -0,0 +1,641 @@
+#include "../../../libs/image/image.hpp"
+#include "../../../libs/util/stopwatch.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+
+namespace img = image;
+namespace mb = memory_buffer;
+
+using p32 = img::Pixel;
+
+
+/* config */
+
+namespace bench
+{
+    class BenchSize
+    {
+    public:
+        cstr name;
+        u32 width;
+        u32 height;
+    };
+
+
+    constexpr BenchSize SIZES[] = 
+    {
+        { "64", 64, 64 },
+        { "720p", 1280, 720 },
+        { "1080p", 1920, 1080 },
+        { "4k", 3840, 2160 },
+    };
+
+
+    // each op runs at least MIN_RUNS times and for at least MIN_TIME_NS, the best run is reported
+    constexpr u32 MIN_RUNS = 3;
+    constexpr u32 MAX_RUNS = 2000;
+    constexpr f64 MIN_TIME_NS = 100.0 * 1000 * 1000;
+
+    // SubViews are inset this far into their image
+    constexpr u32 BORDER = 16;
+}
+
+
+/* results */
+
+namespace bench
+{
+    class Result
+    {
+    public:
+        std::string group;
+        std::string op;
+        std::string size;
+        std::string view;
+
+        u32 width = 0;
+        u32 height = 0;
+        u32 runs = 0;
+
+        f64 ns_per_pixel = 0.0;
+        f64 gb_per_sec = 0.0;
+    };
+
+
+    class Bench
+    {
+    public:
+        std::vector<Result> results;
+
+        BenchSize size;
+        cstr view = "";
+
+        cstr filter = nullptr;
+    };
+
+
+    // bytes_per_pixel is the memory read plus written by one call per pixel of the bench size
+    template <class FUNC>
+    static void run(Bench& b, cstr group, cstr op, f64 bytes_per_pixel, FUNC const& func)
+    {
+        if (b.filter && !std::strstr(op, b.filter))
+        {
+            return;
+        }
+
+        func(); // warm up
+
+        Stopwatch sw;
+        f64 best = 1e300;
+        f64 total = 0.0;
+        u32 runs = 0;
+
+        while (runs < MIN_RUNS || (total < MIN_TIME_NS && runs < MAX_RUNS))
+        {
+            sw.start();
+            func();
+            sw.stop();
+
+            auto ns = sw.get_time_nano();
+            best = ns < best ? ns : best;
+            total += ns;
+            runs++;
+        }
+
+        auto const n_pixels = (f64)b.size.width * b.size.height;
+
+        Result r{};
+        r.group = group;
+        r.op = op;
+        r.size = b.size.name;
+        r.view = b.view;
+        r.width = b.size.width;
+        r.height = b.size.height;
+        r.runs = runs;
+        r.ns_per_pixel = best / n_pixels;
+        r.gb_per_sec = bytes_per_pixel * n_pixels / best; // bytes per ns
+
+        std::printf("%-6s %-6s %-9s %-24s %10.4f ns/px %8.2f GB/s\n", 
+            group, b.size.name, b.view, op, r.ns_per_pixel, r.gb_per_sec);
+
+        b.results.push_back(std::move(r));
+    }
+
+
+    static bool write_json(Bench const& b, u32 n_threads, cstr path)
+    {
+        std::ofstream file(path);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+    #ifdef __AVX2__
+        cstr simd = "true";
+    #else
+        cstr simd = "false";
+    #endif
+
+        file 
+        << "{\n"
+        << "  \"threads\": " << n_threads << ",\n"
+        << "  \"simd_256\": " << simd << ",\n"
+        << "  \"results\": [\n";
+
+        for (u32 i = 0; i < b.results.size(); i++)
+        {
+            auto const& r = b.results[i];
+
+            file
+            << "    { "
+            << "\"group\": \"" << r.group << "\", "
+            << "\"op\": \"" << r.op << "\", "
+            << "\"size\": \"" << r.size << "\", "
+            << "\"view\": \"" << r.view << "\", "
+            << "\"width\": " << r.width << ", "
+            << "\"height\": " << r.height << ", "
+            << "\"runs\": " << r.runs << ", "
+            << "\"ns_per_pixel\": " << r.ns_per_pixel << ", "
+            << "\"gb_per_sec\": " << r.gb_per_sec
+            << " }" << (i + 1 < b.results.size() ? "," : "") << "\n";
+        }
+
+        file
+        << "  ]\n"
+        << "}\n";
+
+        return true;
+    }
+}
+
+
+/* data */
+
+namespace bench
+{
+    // images are square with a border so that every view and its transpose fit
+    class BenchData
+    {
+    public:
+        img::Image src;
+        img::Image dst;
+        img::Image aux;
+
+        img::ImageGray gray_src;
+        img::ImageGray gray_dst;
+
+        img::Buffer32 scratch32;
+        img::Buffer8 scratch8;
+    };
+
+
+    static bool create_data(BenchData& data, u32 width, u32 height)
+    {
+        auto const n = (width > height ? width : height) + 2 * BORDER;
+
+        if (!img::create_image(data.src, n, n) || 
+            !img::create_image(data.dst, n, n) || 
+            !img::create_image(data.aux, n, n) ||
+            !img::create_image(data.gray_src, n, n) ||
+            !img::create_image(data.gray_dst, n, n))
+        {
+            return false;
+        }
+
+        data.scratch32 = img::create_buffer32(width * height, "bench");
+        data.scratch8 = img::create_buffer8(width * height, "bench");
+
+        if (!data.scratch32.ok || !data.scratch8.ok)
+        {
+            return false;
+        }
+
+        u32 r = 0x1234567;
+        auto const next = [&]() { r = r * 1664525u + 1013904223u; return r; };
+
+        for (u32 i = 0; i < n * n; i++)
+        {
+            auto c = next();
+            data.src.data_[i] = img::to_pixel((u8)(c >> 8), (u8)(c >> 16), (u8)(c >> 24), (u8)c);
+            data.dst.data_[i] = img::to_pixel((u8)(c >> 24), (u8)(c >> 8), (u8)(c >> 16));
+            data.aux.data_[i] = data.dst.data_[i];
+            data.gray_src.data_[i] = (u8)(c >> 12);
+        }
+
+        return true;
+    }
+
+
+    static void destroy_data(BenchData& data)
+    {
+        img::destroy_image(data.src);
+        img::destroy_image(data.dst);
+        img::destroy_image(data.aux);
+        img::destroy_image(data.gray_src);
+        img::destroy_image(data.gray_dst);
+
+        mb::destroy_buffer(data.scratch32);
+        mb::destroy_buffer(data.scratch8);
+    }
+
+
+    template <class T>
+    static void view_of(Matrix2D<T> const& image, u32 width, u32 height, MatrixView2D<T>& view)
+    {
+        view = img::make_view(width, height, image.data_);
+    }
+
+
+    template <class T>
+    static void view_of(Matrix2D<T> const& image, u32 width, u32 height, img::MatrixSubView2D<T>& view)
+    {
+        view = img::sub_view(img::make_view(image), img::make_rect(BORDER, BORDER, width, height));
+    }
+
+
+    template <class VIEW, class T>
+    static VIEW view_of(Matrix2D<T> const& image, u32 width, u32 height)
+    {
+        VIEW view;
+        view_of(image, width, height, view);
+
+        return view;
+    }
+
+
+    static img::SubView to_sub(img::ImageView const& view) { return img::sub_view(view); }
+
+    static img::SubView to_sub(img::SubView const& view) { return view; }
+}
+
+
+/* bounding box */
+
+namespace bench
+{
+    // Shapes drawn by testing every pixel of their bounding box with for_each_xy.
+    // Baselines for the span rasterizers.
+
+    static Rect2Du32 bounding_box(img::SubView const& view, Point2Di32 const* points, u32 count)
+    {
+        auto x_min = points[0].x;
+        auto x_max = points[0].x;
+        auto y_min = points[0].y;
+        auto y_max = points[0].y;
+
+        for (u32 i = 1; i < count; i++)
+        {
+            x_min = points[i].x < x_min ? points[i].x : x_min;
+            x_max = points[i].x > x_max ? points[i].x : x_max;
+            y_min = points[i].y < y_min ? points[i].y : y_min;
+            y_max = points[i].y > y_max ? points[i].y : y_max;
+        }
+
+        auto const clamp = [](i32 v, u32 end) { return v < 0 ? 0u : (u32)v > end ? end : (u32)v; };
+
+        Rect2Du32 r{};
+        r.x_begin = clamp(x_min, view.width);
+        r.x_end = clamp(x_max + 1, view.width);
+        r.y_begin = clamp(y_min, view.height);
+        r.y_end = clamp(y_max + 1, view.height);
+
+        return r;
+    }
+
+
+    static i64 edge(Point2Di32 a, Point2Di32 b, i64 x, i64 y)
+    {
+        return ((i64)b.x - a.x) * (y - a.y) - ((i64)b.y - a.y) * (x - a.x);
+    }
+
+
+    static void triangle_fill_xy(img::SubView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, img::Pixel color)
+    {
+        Point2Di32 points[] = { p0, p1, p2 };
+        auto const r = bounding_box(view, points, 3);
+        if (r.x_begin == r.x_end || r.y_begin == r.y_end)
+        {
+            return;
+        }
+
+        auto const box = img::sub_view(view, r);
+
+        img::for_each_xy(box, [&](u32 x, u32 y)
+        {
+            i64 px = r.x_begin + x;
+            i64 py = r.y_begin + y;
+
+            auto e0 = edge(p0, p1, px, py);
+            auto e1 = edge(p1, p2, px, py);
+            auto e2 = edge(p2, p0, px, py);
+
+            if ((e0 >= 0 && e1 >= 0 && e2 >= 0) || (e0 <= 0 && e1 <= 0 && e2 <= 0))
+            {
+                img::internal::view_row(box, y)[x] = color;
+            }
+        });
+    }
+
+
+    // 1 pixel wide, within half a pixel of the line along the minor axis
+    static void line_xy(img::SubView const& view, Point2Di32 p0, Point2Di32 p1, img::Pixel color)
+    {
+        Point2Di32 points[] = { p0, p1 };
+        auto const r = bounding_box(view, points, 2);
+        if (r.x_begin == r.x_end || r.y_begin == r.y_end)
+        {
+            return;
+        }
+
+        auto const box = img::sub_view(view, r);
+
+        i64 adx = p1.x > p0.x ? (i64)p1.x - p0.x : (i64)p0.x - p1.x;
+        i64 ady = p1.y > p0.y ? (i64)p1.y - p0.y : (i64)p0.y - p1.y;
+        i64 major = adx > ady ? adx : ady;
+
+        img::for_each_xy(box, [&](u32 x, u32 y)
+        {
+            auto e = edge(p0, p1, r.x_begin + x, r.y_begin + y);
+
+            if (2 * (e < 0 ? -e : e) <= major)
+            {
+                img::internal::view_row(box, y)[x] = color;
+            }
+        });
+    }
+}
+
+
+/* span */
+
+namespace bench
+{
+    static void run_span(Bench& b, BenchData& data)
+    {
+        auto const n = b.size.width * b.size.height;
+
+        auto src = span::make_view(data.src.data_, n);
+        auto dst = span::make_view(data.dst.data_, n);
+        auto src8 = span::make_view(data.gray_src.data_, n);
+        auto dst8 = span::make_view(data.gray_dst.data_, n);
+
+        // 4 byte elements read as f32
+        auto fa = span::make_view((f32*)data.aux.data_, n);
+        auto fb = span::make_view((f32*)data.scratch32.data_, n);
+        auto fd = span::make_view((f32*)data.dst.data_, n);
+
+        span::fill_32(fa, 1.5f);
+        span::fill_32(fb, 0.25f);
+
+        auto const color = img::to_pixel(10, 20, 30);
+
+        f32 sink = 0.0f;
+
+        run(b, "span", "copy", 8, [&](){ span::copy(src, dst); });
+        run(b, "span", "copy_u8", 2, [&](){ span::copy(src8, dst8); });
+        run(b, "span", "fill_32", 4, [&](){ span::fill_32(dst, color); });
+        run(b, "span", "fill_8", 1, [&](){ span::fill_8(dst8, (u8)7); });
+        run(b, "span", "add", 12, [&](){ span::add(fa, fb, fd); });
+        run(b, "span", "sub", 12, [&](){ span::sub(fa, fb, fd); });
+        run(b, "span", "mul", 8, [&](){ span::mul(fa, 0.5f, fd); });
+        run(b, "span", "dot", 8, [&](){ sink += span::dot(fa, fb); });
+        run(b, "span", "transform", 8, [&](){ span::transform(src, dst, [](p32 p){ p.alpha = 255; return p; }); });
+
+        if (sink == 1.0f)
+        {
+            std::printf(" ");
+        }
+    }
+}
+
+
+/* image */
+
+namespace bench
+{
+    template <class VIEW>
+    static void run_image(Bench& b, BenchData& data)
+    {
+        constexpr bool IS_SUB = std::is_same_v<VIEW, img::SubView>;
+
+        auto const w = b.size.width;
+        auto const h = b.size.height;
+
+        auto src = view_of<VIEW>(data.src, w, h);
+        auto dst = view_of<VIEW>(data.dst, w, h);
+        auto dst_t = view_of<VIEW>(data.dst, h, w);
+        auto half = view_of<VIEW>(data.aux, w / 2, h / 2);
+
+        auto dst_sub = to_sub(dst);
+
+        auto const color = img::to_pixel(200, 100, 50, 128);
+        auto const opaque = img::to_pixel(200, 100, 50);
+
+        /* fill copy */
+
+        run(b, "image", "fill", 4, [&](){ img::fill(dst, opaque); });
+        run(b, "image", "fill_blend", 8, [&](){ img::fill_blend(dst_sub, color); });
+        run(b, "image", "fill_blend_add", 8, [&](){ img::fill_blend(dst_sub, color, img::BlendMode::Add); });
+        run(b, "image", "copy", 8, [&](){ img::copy(src, dst); });
+        run(b, "image", "copy_blend", 12, [&](){ img::copy_blend(src, dst_sub); });
+        run(b, "image", "copy_blend_add", 12, [&](){ img::copy_blend(src, dst_sub, img::BlendMode::Add); });
+        run(b, "image", "copy_blend_multiply", 12, [&](){ img::copy_blend(src, dst_sub, img::BlendMode::Multiply); });
+        /* templated callable vs fn<> */
+
+        auto const keep_alpha = [](p32 s, p32 d){ s.alpha = d.alpha; return s; };
+        auto const gradient = [](u32 x, u32 y){ return img::to_pixel((u8)x, (u8)y, (u8)(x + y)); };
+
+        fn<img::Pixel(img::Pixel, img::Pixel)> const keep_alpha_fn = keep_alpha;
+        fn<img::Pixel(u32, u32)> const gradient_fn = gradient;
+
+        run(b, "image", "transform", 12, [&](){ img::transform(src, dst_sub, keep_alpha); });
+        run(b, "image", "transform_fn", 12, [&](){ img::transform(src, dst_sub, keep_alpha_fn); });
+        run(b, "image", "for_each_xy", 4, [&](){ img::for_each_xy(dst, gradient); });
+        run(b, "image", "for_each_xy_fn", 4, [&](){ img::for_each_xy(dst, gradient_fn); });
+
+        /* rotate flip */
+
+        run(b, "image", "rotate_90", 8, [&](){ img::rotate_90(src, dst_t); });
+        run(b, "image", "rotate_180", 8, [&](){ img::rotate_180(src, dst); });
+        run(b, "image", "rotate_270", 8, [&](){ img::rotate_270(src, dst_t); });
+        run(b, "image", "flip_h", 8, [&](){ img::flip_h(src, dst); });
+
+        if constexpr (!IS_SUB)
+        {
+            Point2Di32 sp = { (i32)w / 2, (i32)h / 2 };
+            Point2Du32 spu = { w / 2, h / 2 };
+
+            run(b, "image", "rotate", 8, [&](){ img::rotate(src, dst, spu, spu, 0.1f); });
+            run(b, "image", "rotate_blend", 12, [&](){ img::rotate_blend(src, dst_sub, sp, sp, 0.1f); });
+            run(b, "image", "flip_v", 8, [&](){ img::flip_v(src, dst_sub); });
+            run(b, "image", "flip_h_blend", 12, [&](){ img::flip_h_blend(src, dst_sub); });
+        }
+
+        /* resize */
+
+        run(b, "image", "scale_down_2", 5, [&](){ img::scale_down(src, half, 2); });
+        run(b, "image", "scale_up_2", 5, [&](){ img::scale_up(half, dst, 2); });
+
+        if constexpr (!IS_SUB)
+        {
+            run(b, "image", "resize_half", 5, [&](){ img::resize(src, half); });
+        }
+
+        /* filter */
+
+        run(b, "image", "blur_box_4", 16, [&](){ img::blur_box(src, dst, 4, data.scratch32); });
+        run(b, "image", "blur_gaussian_3", 48, [&](){ img::blur_gaussian(src, dst, 3.0f, data.scratch32); });
+
+        auto lut = img::combine(img::make_lut_gamma(2.2f), img::make_lut_contrast(1.2f));
+
+        run(b, "image", "copy_lut", 8, [&](){ img::copy_lut(src, dst, lut); });
+        run(b, "image", "apply_lut", 8, [&](){ img::apply_lut(dst, lut); });
+
+        /* stats */
+
+        img::stats::Histogram hist;
+        u64 sink = 0;
+
+        run(b, "image", "histogram", 4, [&](){ img::stats::histogram(src, hist); });
+        run(b, "image", "min_max_mean", 4, [&](){ sink += img::stats::min_max_mean(src).mean.red; });
+        run(b, "image", "count_coverage", 4, [&](){ sink += img::stats::count_coverage(src); });
+        run(b, "image", "coverage_bounds", 4, [&](){ sink += img::stats::coverage_bounds(src).x_end; });
+        run(b, "image", "centroid", 4, [&](){ sink += img::stats::centroid(src).x; });
+
+        /* draw */
+
+        Point2Di32 center = { (i32)w / 2, (i32)h / 2 };
+        auto const radius = (h < w ? h : w) / 2;
+
+        Point2Di32 quad[] = { { 0, 0 }, { (i32)w - 1, (i32)h / 4 }, { (i32)w - 1, (i32)h - 1 }, { (i32)w / 4, (i32)h - 1 } };
+        SpanView<Point2Di32> points{};
+        points.data = quad;
+        points.length = 4;
+
+        img::draw::NineSliceInsets insets{ 8, 8, 8, 8 };
+        auto panel = view_of<VIEW>(data.src, 48, 48);
+
+        // fraction of the view covered
+        constexpr f64 circle_area = 3.14159 / 4;
+
+        run(b, "draw", "circle_fill", 4 * circle_area, [&](){ img::draw::circle_fill(dst, center, radius, opaque); });
+        run(b, "draw", "triangle_fill", 2, [&](){ img::draw::triangle_fill(dst, quad[0], quad[1], quad[2], opaque); });
+        run(b, "draw", "triangle_fill_xy", 2, [&](){ triangle_fill_xy(dst_sub, quad[0], quad[1], quad[2], opaque); });
+
+        // diagonal, 1 pixel per step of the longer side
+        auto const line_bytes = 4.0 * (w > h ? w : h) / ((f64)w * h);
+
+        run(b, "draw", "line", line_bytes, [&](){ img::draw::line(dst_sub, quad[0], quad[2], 1, opaque); });
+        run(b, "draw", "line_xy", line_bytes, [&](){ line_xy(dst_sub, quad[0], quad[2], opaque); });
+        run(b, "draw", "polygon_fill_blend", 0.6 * 8,[&](){ img::draw::polygon_fill_blend(dst, points, color); });
+        run(b, "draw", "nine_slice", 4, [&](){ img::draw::nine_slice(panel, insets, dst_sub); });
+        run(b, "draw", "nine_slice_blend", 8, [&](){ img::draw::nine_slice_blend(panel, insets, dst_sub); });
+
+        /* gray */
+
+        auto gsrc = view_of<std::conditional_t<IS_SUB, img::GraySubView, img::GrayView>>(data.gray_src, w, h);
+        auto gdst = view_of<std::conditional_t<IS_SUB, img::GraySubView, img::GrayView>>(data.gray_dst, w, h);
+
+        img::stats::GrayHistogram ghist;
+
+        run(b, "gray", "fill", 1, [&](){ img::fill(gdst, (u8)3); });
+        run(b, "gray", "blur_box_4", 4, [&](){ img::blur_box(gsrc, gdst, 4, data.scratch8); });
+        run(b, "gray", "histogram", 1, [&](){ img::stats::histogram(gsrc, ghist); });
+        run(b, "gray", "min_max_mean", 1, [&](){ sink += img::stats::min_max_mean(gsrc).mean; });
+
+        if constexpr (!IS_SUB)
+        {
+            img::Palette palette;
+            for (u32 i = 0; i < palette.count; i++)
+            {
+                palette.colors[i] = img::to_pixel((u8)i, (u8)(255 - i), (u8)(i * 7));
+            }
+
+            auto ghalf = view_of<img::GrayView>(data.gray_src, w / 2, h / 2);
+
+            run(b, "gray", "expand", 5, [&](){ img::expand(gsrc, dst, palette); });
+            run(b, "gray", "scale_up_2_palette", 4.25, [&](){ img::scale_up(ghalf, dst, 2, palette); });
+        }
+
+        /* pyramid */
+
+        if constexpr (!IS_SUB)
+        {
+            img::Pyramid pyramid;
+            if (img::create_pyramid(pyramid, src))
+            {
+                run(b, "image", "update_pyramid", 4 + 8 / 3.0, [&](){ img::update_pyramid(pyramid, src); });
+                run(b, "image", "pyramid_sample", 4.25, [&](){ img::sample(pyramid, dst); });
+
+                img::destroy_pyramid(pyramid);
+            }
+        }
+
+        if (sink == 1)
+        {
+            std::printf(" ");
+        }
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    // bench [json path] [threads] [op filter]
+    cstr json_path = argc > 1 ? argv[1] : "bench.json";
+    u32 n_threads = argc > 2 ? (u32)std::atoi(argv[2]) : img::hardware_threads();
+
+    bench::Bench b;
+    b.filter = argc > 3 ? argv[3] : nullptr;
+
+    img::Execution ex{};
+    ex.n_threads = n_threads ? n_threads : 1;
+    img::ExecutionScope scope(ex);
+
+    std::printf("threads: %u\n\n", ex.n_threads);
+
+    for (auto const& size : bench::SIZES)
+    {
+        bench::BenchData data;
+        if (!bench::create_data(data, size.width, size.height))
+        {
+            std::printf("%s: allocation failed\n", size.name);
+            continue;
+        }
+
+        b.size = size;
+
+        b.view = "span";
+        bench::run_span(b, data);
+
+        b.view = "ImageView";
+        bench::run_image<img::ImageView>(b, data);
+
+        b.view = "SubView";
+        bench::run_image<img::SubView>(b, data);
+
+        bench::destroy_data(data);
+
+        std::printf("\n");
+    }
+
+    if (!bench::write_json(b, ex.n_threads, json_path))
+    {
+        std::printf("could not write %s\n", json_path);
+        return 1;
+    }
+
+    std::printf("%s\n", json_path);
+
+    return 0;
+}
+
+
+#include "../../../libs/alloc_type/alloc_type.cpp"
+#include "../../../libs/span/span.cpp"
+#include "../../../libs/image/image.cpp"
+#include "../../../libs/stb_libs/stb_libs.cpp"
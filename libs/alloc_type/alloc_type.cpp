@@ -0,0 +1,47 @@
+#pragma once
+
+#include "alloc_type.hpp"
+
+#include <cstdlib>
+
+// Plain C++ allocator for tools built without SDL.
+// Allocations are zeroed like sdl_alloc, tags are ignored and nothing is counted.
+
+
+namespace mem
+{    
+    void* alloc_memory(u32 n_elements, u32 element_size, cstr tag)
+    {
+        return std::calloc(n_elements, element_size);
+    }
+
+
+    void add_memory(void* ptr, u32 n_elements, u32 element_size, cstr tag)
+    {
+
+    }
+
+
+    void free_memory(void* ptr, u32 element_size)
+    {
+        std::free(ptr);
+    }
+
+
+    void tag_memory(void* ptr, u32 n_elements, u32 element_size, cstr tag)
+    {
+
+    }
+
+
+    void tag_file_memory(void* ptr, u32 element_size, cstr file_path)
+    {
+
+    }
+
+
+    void untag_memory(void* ptr, u32 element_size)
+    {
+
+    }
+}
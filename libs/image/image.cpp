@@ -5,6 +5,13 @@
 
 #include "../stb_libs/stb_image_options.hpp"
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <bit>
+#include <cmath>
+
 namespace image
 {
     namespace sp = span;
@@ -12,6 +19,15 @@ namespace image
 }
 
 
+#ifdef __AVX2__
+#define IMAGE_SIMD_256
+// -mavx -mavx2 -mfma
+
+#include <immintrin.h>
+
+#endif
+
+
 /* create/destroy */
 
 namespace image
@@ -91,6 +107,20 @@ namespace image
     {
         return view.matrix_data_ + (u64)(view.y_begin + y) * view.matrix_width + view.x_begin;
     }
+
+
+    template <typename T>
+    static inline i64 row_stride(MatrixView2D<T> const& view)
+    {
+        return (i64)view.width;
+    }
+
+
+    template <typename T>
+    static inline i64 row_stride(MatrixSubView2D<T> const& view)
+    {
+        return (i64)view.matrix_width;
+    }
 }
 
 
@@ -166,6 +196,306 @@ namespace image
 }
 
 
+/* row_band */
+
+namespace image
+{
+    template <typename T>
+    static inline MatrixView2D<T> row_band(MatrixView2D<T> const& view, u32 y_begin, u32 y_end)
+    {
+        MatrixView2D<T> band{};
+
+        band.matrix_data_ = view.matrix_data_ + (u64)y_begin * view.width;
+        band.width = view.width;
+        band.height = y_end - y_begin;
+
+        return band;
+    }
+
+
+    template <typename T>
+    static inline MatrixSubView2D<T> row_band(MatrixSubView2D<T> const& view, u32 y_begin, u32 y_end)
+    {
+        auto band = view;
+
+        band.y_begin = view.y_begin + y_begin;
+        band.height = y_end - y_begin;
+
+        return band;
+    }
+
+
+    template <typename T>
+    static inline MatrixSubView2D<T> column_band(MatrixView2D<T> const& view, u32 x_begin, u32 x_end)
+    {
+        MatrixSubView2D<T> band{};
+
+        band.matrix_data_ = view.matrix_data_;
+        band.matrix_width = view.width;
+        band.x_begin = x_begin;
+        band.y_begin = 0;
+        band.width = x_end - x_begin;
+        band.height = view.height;
+
+        return band;
+    }
+
+
+    template <typename T>
+    static inline MatrixSubView2D<T> column_band(MatrixSubView2D<T> const& view, u32 x_begin, u32 x_end)
+    {
+        auto band = view;
+
+        band.x_begin = view.x_begin + x_begin;
+        band.width = x_end - x_begin;
+
+        return band;
+    }
+}
+
+
+/* execution */
+
+namespace image
+{
+namespace exe
+{
+    constexpr u32 MAX_THREADS = 32;
+
+    using band_fn = fn<void(u32 y_begin, u32 y_end)>;
+
+
+    class WorkerPool
+    {
+    public:
+        std::thread threads[MAX_THREADS - 1];
+        u32 n_threads = 0;
+
+        std::mutex mutex;
+        std::condition_variable cv_start;
+        std::condition_variable cv_done;
+
+        u64 job_id = 0;
+        u32 n_active = 0;
+        bool stop = false;
+
+        band_fn const* job = 0;
+        u32 n_rows = 0;
+        u32 band_rows = 0;
+        u32 n_bands = 0;
+        u32 bands_done = 0;
+
+        std::atomic<u32> next_band = 0;
+
+        ~WorkerPool();
+    };
+
+
+    static Execution execution{};
+    static WorkerPool pool;
+
+
+    static u32 run_bands(band_fn const& job, u32 n_rows, u32 band_rows, u32 n_bands)
+    {
+        u32 count = 0;
+
+        for (auto b = pool.next_band.fetch_add(1); b < n_bands; b = pool.next_band.fetch_add(1))
+        {
+            auto y_begin = b * band_rows;
+            auto y_end = num::min(y_begin + band_rows, n_rows);
+
+            job(y_begin, y_end);
+            ++count;
+        }
+
+        return count;
+    }
+
+
+    static void worker_proc()
+    {
+        u64 job_id = 0;
+
+        for (;;)
+        {
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            pool.cv_start.wait(lock, [&]() { return pool.stop || pool.job_id != job_id; });
+
+            if (pool.stop)
+            {
+                return;
+            }
+
+            job_id = pool.job_id;
+            ++pool.n_active;
+
+            auto& job = *pool.job;
+            auto n_rows = pool.n_rows;
+            auto band_rows = pool.band_rows;
+            auto n_bands = pool.n_bands;
+
+            lock.unlock();
+
+            auto count = run_bands(job, n_rows, band_rows, n_bands);
+
+            lock.lock();
+            pool.bands_done += count;
+            --pool.n_active;
+            lock.unlock();
+
+            pool.cv_done.notify_one();
+        }
+    }
+
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+
+        cv_start.notify_all();
+
+        for (u32 i = 0; i < n_threads; i++)
+        {
+            threads[i].join();
+        }
+    }
+
+
+    static void start_workers(u32 n_workers)
+    {
+        n_workers = num::min(n_workers, MAX_THREADS - 1);
+
+        for (; pool.n_threads < n_workers; pool.n_threads++)
+        {
+            pool.threads[pool.n_threads] = std::thread(worker_proc);
+        }
+    }
+
+
+    static void run_job(band_fn const& job, u32 n_rows, u32 n_bands)
+    {
+        start_workers(n_bands - 1);
+
+        auto band_rows = (n_rows + n_bands - 1) / n_bands;
+        n_bands = (n_rows + band_rows - 1) / band_rows;
+
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        pool.cv_done.wait(lock, [&]() { return pool.n_active == 0; });
+
+        pool.job = &job;
+        pool.n_rows = n_rows;
+        pool.band_rows = band_rows;
+        pool.n_bands = n_bands;
+        pool.bands_done = 0;
+        pool.next_band = 0;
+        ++pool.job_id;
+
+        lock.unlock();
+        pool.cv_start.notify_all();
+
+        auto count = run_bands(job, n_rows, band_rows, n_bands);
+
+        lock.lock();
+        pool.bands_done += count;
+        pool.cv_done.wait(lock, [&]() { return pool.bands_done == n_bands && pool.n_active == 0; });
+    }
+
+
+    static u32 count_bands(u32 n_rows, u32 min_rows)
+    {
+        auto n_threads = num::min(execution.n_threads, MAX_THREADS);
+        min_rows = num::max(min_rows, 1u);
+
+        return num::max(num::min(n_threads, n_rows / min_rows), 1u);
+    }
+
+
+    template <class FUNC>
+    static void for_each_band(u32 n_rows, u32 min_rows, FUNC const& func)
+    {
+        auto n_bands = count_bands(n_rows, min_rows);
+        if (n_bands < 2)
+        {
+            func(0, n_rows);
+            return;
+        }
+
+        band_fn job = func;
+        run_job(job, n_rows, n_bands);
+    }
+
+
+    template <class FUNC>
+    static void for_each_band(u32 n_rows, FUNC const& func)
+    {
+        for_each_band(n_rows, execution.min_rows, func);
+    }
+
+
+    template <class VIEW, class FUNC>
+    static void for_each_row_band(VIEW const& view, FUNC const& func)
+    {
+        for_each_band(view.height, [&](u32 y_begin, u32 y_end)
+        {
+            func(row_band(view, y_begin, y_end));
+        });
+    }
+
+
+    template <class V_SRC, class V_DST, class FUNC>
+    static void for_each_row_band(V_SRC const& src, V_DST const& dst, FUNC const& func)
+    {
+        for_each_band(dst.height, [&](u32 y_begin, u32 y_end)
+        {
+            func(row_band(src, y_begin, y_end), row_band(dst, y_begin, y_end));
+        });
+    }
+}
+}
+
+
+/* execution api */
+
+namespace image
+{
+    u32 hardware_threads()
+    {
+        auto n = std::thread::hardware_concurrency();
+
+        return num::max(num::min(n, exe::MAX_THREADS), 1u);
+    }
+
+
+    Execution get_execution()
+    {
+        return exe::execution;
+    }
+
+
+    void set_execution(Execution const& ex)
+    {
+        exe::execution.n_threads = num::max(num::min(ex.n_threads, exe::MAX_THREADS), 1u);
+        exe::execution.min_rows = num::max(ex.min_rows, 1u);
+    }
+
+
+    void for_each_band(u32 n_rows, fn<void(u32 y_begin, u32 y_end)> const& func)
+    {
+        auto n_bands = exe::count_bands(n_rows, exe::execution.min_rows);
+        if (n_bands < 2)
+        {
+            func(0, n_rows);
+            return;
+        }
+
+        exe::run_job(func, n_rows, n_bands);
+    }
+}
+
+
 /* make_view */
 
 namespace image
@@ -281,11 +611,24 @@ namespace image
     }
 
 
-    static void alpha_blend(Pixel s, Pixel* dst)
+    static inline u8 alpha_blend_u8(u32 s, u32 d, u32 a)
     {
-        constexpr auto scale = 1.0f / 255.0f;
+        // round((a * s + (255 - a) * d) / 255) without division
+        u32 x = a * s + (255 - a) * d + 128;
 
-        f32 a = 1.0f;
+        return (u8)((x + (x >> 8)) >> 8);
+    }
+
+
+    static inline u8 alpha_blend_half_u8(u32 s, u32 d)
+    {
+        return (u8)((s + d + 1) >> 1);
+    }
+
+
+    static void alpha_blend(Pixel s, Pixel* dst)
+    {
+        auto& d = *dst;
 
         switch (s.alpha)
         {
@@ -293,22 +636,27 @@ namespace image
             return;
 
         case 255: 
-            *dst = s;            
+            d = s;            
             return;
 
         case 126:
         case 127:
         case 128:
         case 129:
-            a = 0.5f;
-            break;
+            d.red = alpha_blend_half_u8(s.red, d.red);
+            d.green = alpha_blend_half_u8(s.green, d.green);
+            d.blue = alpha_blend_half_u8(s.blue, d.blue);
+            return;
 
         default: 
-            a = s.alpha * scale;
             break;
         }
 
-        alpha_blend(s, dst, a);
+        u32 const a = s.alpha;
+
+        d.red = alpha_blend_u8(s.red, d.red, a);
+        d.green = alpha_blend_u8(s.green, d.green, a);
+        d.blue = alpha_blend_u8(s.blue, d.blue, a);
     }    
 
 
@@ -318,1646 +666,6273 @@ namespace image
     }
 
 
-    static void alpha_blend_span(SpanView<Pixel> const& src, SpanView<Pixel> const& dst)
+    static void alpha_blend(PixelPM s, Pixel* dst)
     {
-        for (u32 i = 0; i < dst.length; ++i) // TODO: simd
-        {
-            alpha_blend(src.data + i, dst.data + i);
-        }
+        // s + d * (255 - a) / 255
+        auto& d = *dst;
+        u32 const i = 255 - s.alpha;
+
+        d.red = (u8)num::min((u32)s.red + mul_div255(d.red, i), 255u);
+        d.green = (u8)num::min((u32)s.green + mul_div255(d.green, i), 255u);
+        d.blue = (u8)num::min((u32)s.blue + mul_div255(d.blue, i), 255u);
+        d.alpha = (u8)num::min((u32)s.alpha + mul_div255(d.alpha, i), 255u);
     }
 
 
-    static void alpha_blend_span(SpanView<Pixel> const& src, SpanView<Pixel> const& dst, f32 alpha)
+    static void alpha_blend(PixelPM* src, Pixel* dst)
     {
-        for (u32 i = 0; i < dst.length; ++i) // TODO: simd
-        {
-            alpha_blend(src.data + i, dst.data + i, alpha);
-        }
+        alpha_blend(*src, dst);
     }
 }
 
 
-/* fill */
+#ifdef IMAGE_SIMD_256
+
+/* alpha_blend simd */
 
 namespace image
 {
-    template <typename T>
-    static void fill_span_if(SpanView<T> const& dst, u8 value, fn<bool(T)> const& pred)
+    static constexpr u32 N_SIMD_PIXELS = 8;
+
+
+    static inline __m256i load_8(Pixel* src)
     {
-        T* d = dst.data;
-        for (u32 i = 0; i < dst.length; ++i)
-		{
-			d[i] = pred(d[i]) ? value : d[i];
-		}
+        return _mm256_loadu_si256((__m256i*)src);
     }
 
 
-    static void fill_span_blend(SpanView<Pixel> const& dst, Pixel value)
+    static inline void store_8(__m256i src, Pixel* dst)
     {
-        Pixel* d = dst.data;
-
-        for (u32 i = 0; i < dst.length; ++i)
-        {
-            alpha_blend(value, d + i); // TODO: simd
-        }
+        _mm256_storeu_si256((__m256i*)dst, src);
     }
 
 
-    void fill(ImageView const& view, Pixel color)
+    static inline __m256i load_8(PixelPM* src)
     {
-        assert(view.matrix_data_);
-
-        sp::fill_32(to_span(view), color);
+        return _mm256_loadu_si256((__m256i*)src);
     }
 
 
-    void fill(SubView const& view, Pixel color)
+    static inline void store_8(__m256i src, PixelPM* dst)
     {
-        assert(view.matrix_data_);
-        assert(view.width);
-        assert(view.height);
-
-        for (u32 y = 0; y < view.height; y++)
-        {
-            sp::fill_32(row_span(view, y), color);
-        }
+        _mm256_storeu_si256((__m256i*)dst, src);
     }
 
 
-    void fill_if(GraySubView const& view, u8 gray, fn<bool(u8)> const& pred)
+    // alpha byte of each pixel copied to its four 16 bit channels
+
+    static inline __m256i alpha_lo_16(__m256i src)
     {
-        assert(view.matrix_data_);
+        auto const shuffle_lo = _mm256_setr_epi8(
+            3, -1, 3, -1, 3, -1, 3, -1, 7, -1, 7, -1, 7, -1, 7, -1,
+            3, -1, 3, -1, 3, -1, 3, -1, 7, -1, 7, -1, 7, -1, 7, -1);
 
-        for (u32 y = 0; y < view.height; y++)
-        {
-            fill_span_if(row_span(view, y), gray, pred);
-        }
+        return _mm256_shuffle_epi8(src, shuffle_lo);
     }
 
 
-    void fill_blend(SubView const& view, Pixel color)
+    static inline __m256i alpha_hi_16(__m256i src)
     {
-        for (u32 y = 0; y < view.height; y++)
-        {
-            fill_span_blend(row_span(view, y), color);
-        }
+        auto const shuffle_hi = _mm256_setr_epi8(
+            11, -1, 11, -1, 11, -1, 11, -1, 15, -1, 15, -1, 15, -1, 15, -1,
+            11, -1, 11, -1, 11, -1, 11, -1, 15, -1, 15, -1, 15, -1, 15, -1);
+
+        return _mm256_shuffle_epi8(src, shuffle_hi);
     }
 
 
-    void fill_row(SubView const& view, u32 y, Pixel color)
+    static inline __m256i mul_div255_16(__m256i a, __m256i b)
     {
-        sp::fill_32(row_span(view, y), color);
+        // x = a * b + 128
+        // (x + (x >> 8)) >> 8
+        auto x = _mm256_add_epi16(_mm256_mullo_epi16(a, b), _mm256_set1_epi16(128));
+
+        return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
     }
 
 
-    void fill_row_blend(SubView const& view, u32 y, Pixel color)
+    static inline __m256i alpha_blend_8(__m256i src, __m256i dst)
     {
-        fill_span_blend(row_span(view, y), color);
-    }
-}
+        auto const zero = _mm256_setzero_si256();
+        auto const c128 = _mm256_set1_epi16(128);
+        auto const c255 = _mm256_set1_epi16(255);
+        auto const alpha_mask = _mm256_set1_epi32((int)0xFF000000);
 
+        auto const blend_16 = [&](__m256i s, __m256i d, __m256i a)
+        {
+            // x = a * s + (255 - a) * d + 128
+            // (x + (x >> 8)) >> 8
+            auto x = _mm256_add_epi16(_mm256_mullo_epi16(s, a), _mm256_mullo_epi16(d, _mm256_sub_epi16(c255, a)));
+            x = _mm256_add_epi16(x, c128);
 
-/* copy */
+            return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+        };
 
-namespace image
-{
-    template <class VIEW_S, class VIEW_D>
-    static void copy_view(VIEW_S const& src, VIEW_D const& dst)
-    {
-        sp::copy(to_span(src), to_span(dst));
-    }
+        auto lo = blend_16(
+            _mm256_unpacklo_epi8(src, zero), 
+            _mm256_unpacklo_epi8(dst, zero), 
+            alpha_lo_16(src));
 
+        auto hi = blend_16(
+            _mm256_unpackhi_epi8(src, zero), 
+            _mm256_unpackhi_epi8(dst, zero), 
+            alpha_hi_16(src));
 
-    template <class VIEW_S, class VIEW_D>
-    static void copy_sub_view(VIEW_S const& src, VIEW_D const& dst)
-    {
-        for (u32 y = 0; y < src.height; y++)
-        {
-            sp::copy(row_span(src, y), row_span(dst, y));
-        }
-    }
+        auto res = _mm256_packus_epi16(lo, hi);
+        auto half = _mm256_avg_epu8(src, dst);
 
+        // 126 <= alpha <= 129
+        auto a32 = _mm256_srli_epi32(src, 24);
+        auto a_half = _mm256_sub_epi32(a32, _mm256_set1_epi32(126));
+        auto is_half = _mm256_cmpeq_epi32(_mm256_min_epu32(a_half, _mm256_set1_epi32(3)), a_half);
+        auto is_opaque = _mm256_cmpeq_epi32(a32, _mm256_set1_epi32(255));
 
-    template <typename V_SRC, typename V_DST>
-    static void copy_blend_sub_view(V_SRC const& src, V_DST const& dst)
-    {
-        for (u32 y = 0; y < src.height; y++)
-        {
-            alpha_blend_span(row_span(src, y), row_span(dst, y));
-        }
+        res = _mm256_blendv_epi8(res, half, is_half);
+        res = _mm256_blendv_epi8(res, dst, alpha_mask);
+
+        return _mm256_blendv_epi8(res, src, is_opaque);
     }
 
 
-    void copy(ImageView const& src, ImageView const& dst)
+    static inline void alpha_blend_8(Pixel* src, Pixel* dst)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        auto const alpha_mask = _mm256_set1_epi32((int)0xFF000000);
 
-        copy_view(src, dst);
-    }    
+        auto s = load_8(src);
 
+        if (_mm256_testz_si256(s, alpha_mask))
+        {
+            // all transparent
+            return;
+        }
 
-    void copy(ImageView const& src, SubView const& dst)
-    {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        if (_mm256_testc_si256(s, alpha_mask))
+        {
+            // all opaque
+            store_8(s, dst);
+            return;
+        }
 
-        copy_sub_view(src, dst);
+        store_8(alpha_blend_8(s, load_8(dst)), dst);
     }
 
 
-    void copy(SubView const& src, ImageView const& dst)
+    static inline __m256i alpha_blend_pm_8(__m256i src, __m256i dst)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        // s + d * (255 - a) / 255
+        auto const zero = _mm256_setzero_si256();
 
-        copy_sub_view(src, dst);
+        auto inv = _mm256_xor_si256(src, _mm256_set1_epi8(-1));
+
+        auto lo = mul_div255_16(_mm256_unpacklo_epi8(dst, zero), alpha_lo_16(inv));
+        auto hi = mul_div255_16(_mm256_unpackhi_epi8(dst, zero), alpha_hi_16(inv));
+
+        return _mm256_adds_epu8(src, _mm256_packus_epi16(lo, hi));
     }
 
 
-    void copy(SubView const& src, SubView const& dst)
+    static inline void alpha_blend_8(PixelPM* src, Pixel* dst)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        auto const alpha_mask = _mm256_set1_epi32((int)0xFF000000);
 
-        copy_sub_view(src, dst);
-    }
+        auto s = load_8(src);
 
+        if (_mm256_testz_si256(s, s))
+        {
+            // nothing to add
+            return;
+        }
 
-    void copy_blend(ImageView const& src, SubView const& dst)
-    {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        if (_mm256_testc_si256(s, alpha_mask))
+        {
+            // all opaque
+            store_8(s, dst);
+            return;
+        }
 
-        copy_blend_sub_view(src, dst);
+        store_8(alpha_blend_pm_8(s, load_8(dst)), dst);
     }
 
 
-    void copy_blend(SubView const& src, ImageView const& dst)
+    static inline __m256i premultiply_8(__m256i src)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        auto const zero = _mm256_setzero_si256();
+        auto const alpha_mask = _mm256_set1_epi32((int)0xFF000000);
 
-        copy_blend_sub_view(src, dst);
+        auto lo = mul_div255_16(_mm256_unpacklo_epi8(src, zero), alpha_lo_16(src));
+        auto hi = mul_div255_16(_mm256_unpackhi_epi8(src, zero), alpha_hi_16(src));
+
+        return _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), src, alpha_mask);
     }
+}
 
+#endif // IMAGE_SIMD_256
 
-    void copy_blend(SubView const& src, SubView const& dst)
+
+/* alpha_blend span */
+
+namespace image
+{
+    static void alpha_blend_span(SpanView<Pixel> const& src, SpanView<Pixel> const& dst)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        auto s = src.data;
+        auto d = dst.data;
+        auto len = dst.length;
 
-        copy_blend_sub_view(src, dst);
-    }
+        u32 i = 0;
 
+    #ifdef IMAGE_SIMD_256
 
-    void copy_blend(ImageView const& src, SubView const& dst, u8 alpha)
-    {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        constexpr u32 N = N_SIMD_PIXELS;
 
-        constexpr auto scale = 1.0f / 255.0f;
+        for (; i + N <= len; i += N)
+        {
+            alpha_blend_8(s + i, d + i);
+        }
 
-        f32 a = 1.0f;
+    #endif
 
-        switch (alpha)
+        for (; i < len; ++i)
         {
-        case 0: 
-            return;
+            alpha_blend(s + i, d + i);
+        }
+    }
 
-        case 255:
-            copy(src, dst);
-            return;
 
-        case 127:
-        case 128:
-            a = 0.5f;
-            break;
+    static void alpha_blend_span(SpanView<PixelPM> const& src, SpanView<Pixel> const& dst)
+    {
+        auto s = src.data;
+        auto d = dst.data;
+        auto len = dst.length;
 
-        default: 
-            a = alpha * scale;
-            break;
+        u32 i = 0;
+
+    #ifdef IMAGE_SIMD_256
+
+        constexpr u32 N = N_SIMD_PIXELS;
+
+        for (; i + N <= len; i += N)
+        {
+            alpha_blend_8(s + i, d + i);
         }
 
-        for (u32 y = 0; y < src.height; y++)
+    #endif
+
+        for (; i < len; ++i)
         {
-            alpha_blend_span(row_span(src, y), row_span(dst, y), a);
+            alpha_blend(s + i, d + i);
         }
     }
-}
-
 
-/* for_each_pixel */
 
-namespace image
-{   
-    template <typename T>
-    static inline void for_each_in_span(SpanView<T> const& span, fn<void(T)> const& func)
+    static void alpha_blend_span(SpanView<Pixel> const& src, SpanView<Pixel> const& dst, f32 alpha)
     {
-        for (u32 i = 0; i < span.length; i++)
+        for (u32 i = 0; i < dst.length; ++i) // TODO: simd
         {
-            func(span.data[i]);
+            alpha_blend(src.data + i, dst.data + i, alpha);
         }
     }
 
 
-    void for_each_pixel(ImageView const& view, fn<void(Pixel)> const& func)
+    static void alpha_blend_span_rev(SpanView<Pixel> const& src, SpanView<Pixel> const& dst)
     {
-        assert(view.matrix_data_);
+        // dst[i] = blend(src[len - 1 - i], dst[i])
 
-        for_each_in_span(to_span(view), func);
-    }
+        auto s = src.data;
+        auto d = dst.data;
+        auto len = dst.length;
 
+        u32 i = 0;
 
-    void for_each_pixel(SubView const& view, fn<void(Pixel)> const& func)
-    {
-        assert(view.matrix_data_);
+    #ifdef IMAGE_SIMD_256
 
-        for (u32 y = 0; y < view.height; y++)
+        constexpr u32 N = N_SIMD_PIXELS;
+
+        auto const rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+        for (; i + N <= len; i += N)
         {
-            for_each_in_span(row_span(view, y), func);
+            auto s8 = _mm256_permutevar8x32_epi32(load_8(s + len - N - i), rev);
+            store_8(alpha_blend_8(s8, load_8(d + i)), d + i);
         }
-    }
-}
-
 
-/* for_each_xy */
+    #endif
 
-namespace image
-{
-    template <class VIEW, class FN>
-    static void for_each_xy_write(VIEW const& view, FN const& xy_func)
-    {
-        for (u32 y = 0; y < view.height; ++y)
+        for (; i < len; ++i)
         {
-            auto d = row_begin(view, y);
-			for (u32 x = 0; x < view.width; ++x)
-            {
-                d[x] = xy_func(x, y);
-            }
+            alpha_blend(s + len - 1 - i, d + i);
         }
     }
 
 
-    template <class VIEW, class FN>
-    static void for_each_xy_exe(VIEW const& view, FN const& xy_func)
+    static void alpha_blend_fill_span(SpanView<Pixel> const& dst, Pixel color)
     {
-        for (u32 y = 0; y < view.height; ++y)
+        switch (color.alpha)
         {
-			for (u32 x = 0; x < view.width; ++x)
-            {
-                xy_func(x, y);
-            }
+        case 0:
+            return;
+
+        case 255:
+            sp::fill_32(dst, color);
+            return;
+
+        default:
+            break;
         }
-    }
 
+        auto d = dst.data;
+        auto len = dst.length;
 
-    void for_each_xy(ImageView const& view, fn<Pixel(u32 x, u32 y)> const& xy_func)
-    {
-        assert(view.matrix_data_);
-        assert(view.width);
-        assert(view.height);
-        
-        for_each_xy_write(view, xy_func);
-    }
+        u32 i = 0;
 
+    #ifdef IMAGE_SIMD_256
 
-    void for_each_xy(SubView const& view, fn<Pixel(u32 x, u32 y)> const& xy_func)
-    {
-        assert(view.matrix_data_);
-        assert(view.width);
-        assert(view.height);
-        
-        for_each_xy_write(view, xy_func);
-    }
+        constexpr u32 N = N_SIMD_PIXELS;
 
+        auto c8 = _mm256_set1_epi32((int)as_u32(color));
 
-    void for_each_xy(ImageView const& view, fn<void(u32 x, u32 y)> const& xy_func)
-    {
-        assert(view.matrix_data_);
-        assert(view.width);
-        assert(view.height);
-        
-        for_each_xy_exe(view, xy_func);
-    }
+        for (; i + N <= len; i += N)
+        {
+            store_8(alpha_blend_8(c8, load_8(d + i)), d + i);
+        }
 
+    #endif
 
-    void for_each_xy(GrayView const& view, fn<u8(u32 x, u32 y)> const& xy_func)
-    {
-        assert(view.matrix_data_);
-        assert(view.width);
-        assert(view.height);
-        
-        for_each_xy_write(view, xy_func);
+        for (; i < len; ++i)
+        {
+            alpha_blend(color, d + i);
+        }
     }
 }
 
 
-/* transform static */
+/* blend mode */
 
 namespace image
 {
-    template <typename P_SRC, typename P_DST>
-    static void transform_span(SpanView<P_SRC> const& src, SpanView<P_DST> const& dst, fn<P_DST(P_SRC, P_DST)> const& func)
+    template <BlendMode M>
+    static inline u8 blend_u8(u32 s, u32 d, u32 a)
     {
-        auto s = src.data;
-        auto d = dst.data;
-
-        for (u32 i = 0; i < src.length; i++)
+        // s is premultiplied by a
+        if constexpr (M == BlendMode::Add)
         {
-            d[i] = func(s[i], d[i]);
+            return (u8)num::min(d + s, 255u);
+        }
+        else if constexpr (M == BlendMode::Subtract)
+        {
+            return (u8)(d > s ? d - s : 0);
+        }
+        else if constexpr (M == BlendMode::Multiply)
+        {
+            // d * lerp(255, s, a) / 255
+            return mul_div255(d, num::min(255 - a + s, 255u));
+        }
+        else if constexpr (M == BlendMode::Screen)
+        {
+            return (u8)(d + s - mul_div255(d, s));
+        }
+        else if constexpr (M == BlendMode::Darken)
+        {
+            return (u8)num::min(d, num::min(s + mul_div255(d, 255 - a), 255u));
+        }
+        else
+        {
+            static_assert(M == BlendMode::Lighten);
+            return (u8)num::max(d, num::min(s + mul_div255(d, 255 - a), 255u));
         }
     }
-    
 
-    template <typename P_SRC, typename P_DST>
-    static void transform_span(SpanView<P_SRC> const& src, SpanView<P_DST> const& dst, fn<P_DST(P_SRC)> const& func)
-    {
-        auto s = src.data;
-        auto d = dst.data;
 
-        for (u32 i = 0; i < src.length; i++)
+    template <BlendMode M>
+    static inline void blend(PixelPM s, Pixel* dst)
+    {
+        if constexpr (M == BlendMode::Alpha)
         {
-            d[i] = func(s[i]);
+            alpha_blend(s, dst);
+        }
+        else
+        {
+            // dst alpha is kept
+            auto& d = *dst;
+            u32 const a = s.alpha;
+
+            d.red = blend_u8<M>(s.red, d.red, a);
+            d.green = blend_u8<M>(s.green, d.green, a);
+            d.blue = blend_u8<M>(s.blue, d.blue, a);
         }
     }
 
 
-    template <class V_SRC, class V_DST, class FUNC>
-    static void transform_view(V_SRC const& src, V_DST const& dst, FUNC const& func)
+    template <BlendMode M>
+    static inline void blend(Pixel s, Pixel* dst)
     {
-        transform_span(to_span(src), to_span(dst), func);
+        if constexpr (M == BlendMode::Alpha)
+        {
+            alpha_blend(s, dst);
+        }
+        else
+        {
+            blend<M>(to_premultiplied(s), dst);
+        }
     }
 
 
-    template <class V_SRC, class V_DST, class FUNC>
-    static void transform_sub_view(V_SRC const& src, V_DST const& dst, FUNC const& func)
+    // one call per draw, every mode gets its own inlined loop
+    template <class FUNC>
+    static void blend_mode_dispatch(BlendMode mode, FUNC const& func)
     {
-        for (u32 y = 0; y < src.height; y++)
+        using BM = BlendMode;
+
+        switch (mode)
         {
-            transform_span(row_span(src, y), row_span(dst, y), func);
+        case BM::Add: func(std::integral_constant<BM, BM::Add>{}); return;
+        case BM::Multiply: func(std::integral_constant<BM, BM::Multiply>{}); return;
+        case BM::Screen: func(std::integral_constant<BM, BM::Screen>{}); return;
+        case BM::Darken: func(std::integral_constant<BM, BM::Darken>{}); return;
+        case BM::Lighten: func(std::integral_constant<BM, BM::Lighten>{}); return;
+        case BM::Subtract: func(std::integral_constant<BM, BM::Subtract>{}); return;
+        default: func(std::integral_constant<BM, BM::Alpha>{}); return;
         }
     }
-
 }
 
 
-/* transform api */
+#ifdef IMAGE_SIMD_256
+
+/* blend mode simd */
 
 namespace image
-{   
-    
-    void transform(ImageView const& src, SubView const& dst, fn<Pixel(Pixel, Pixel)> const& func)
+{
+    template <BlendMode M>
+    static inline __m256i blend_pm_8(__m256i src, __m256i dst)
+    {
+        // src premultiplied, dst alpha is kept
+        static_assert(M != BlendMode::Alpha);
+
+        auto const zero = _mm256_setzero_si256();
+        auto const alpha_mask = _mm256_set1_epi32((int)0xFF000000);
+
+        __m256i res;
+
+        if constexpr (M == BlendMode::Add)
+        {
+            res = _mm256_adds_epu8(dst, src);
+        }
+        else if constexpr (M == BlendMode::Subtract)
+        {
+            res = _mm256_subs_epu8(dst, src);
+        }
+        else if constexpr (M == BlendMode::Multiply)
+        {
+            // d * min(255 - a + s, 255) / 255
+            auto const c255 = _mm256_set1_epi16(255);
+            auto const inv = _mm256_xor_si256(src, _mm256_set1_epi8(-1));
+
+            auto m_lo = _mm256_min_epi16(_mm256_add_epi16(alpha_lo_16(inv), _mm256_unpacklo_epi8(src, zero)), c255);
+            auto m_hi = _mm256_min_epi16(_mm256_add_epi16(alpha_hi_16(inv), _mm256_unpackhi_epi8(src, zero)), c255);
+
+            auto lo = mul_div255_16(_mm256_unpacklo_epi8(dst, zero), m_lo);
+            auto hi = mul_div255_16(_mm256_unpackhi_epi8(dst, zero), m_hi);
+
+            res = _mm256_packus_epi16(lo, hi);
+        }
+        else if constexpr (M == BlendMode::Screen)
+        {
+            // d + s - d * s / 255
+            auto const screen_16 = [](__m256i s, __m256i d)
+            {
+                return _mm256_sub_epi16(_mm256_add_epi16(d, s), mul_div255_16(d, s));
+            };
+
+            auto lo = screen_16(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(dst, zero));
+            auto hi = screen_16(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(dst, zero));
+
+            res = _mm256_packus_epi16(lo, hi);
+        }
+        else if constexpr (M == BlendMode::Darken)
+        {
+            res = _mm256_min_epu8(dst, alpha_blend_pm_8(src, dst));
+        }
+        else
+        {
+            static_assert(M == BlendMode::Lighten);
+            res = _mm256_max_epu8(dst, alpha_blend_pm_8(src, dst));
+        }
+
+        return _mm256_blendv_epi8(res, dst, alpha_mask);
+    }
+}
+
+#endif // IMAGE_SIMD_256
+
+
+/* blend mode span */
+
+namespace image
+{
+    template <BlendMode M>
+    static void blend_span(SpanView<Pixel> const& src, SpanView<Pixel> const& dst)
+    {
+        if constexpr (M == BlendMode::Alpha)
+        {
+            alpha_blend_span(src, dst);
+        }
+        else
+        {
+            auto s = src.data;
+            auto d = dst.data;
+            auto len = dst.length;
+
+            u32 i = 0;
+
+        #ifdef IMAGE_SIMD_256
+
+            constexpr u32 N = N_SIMD_PIXELS;
+
+            auto const alpha_mask = _mm256_set1_epi32((int)0xFF000000);
+
+            for (; i + N <= len; i += N)
+            {
+                auto s8 = load_8(s + i);
+
+                if (_mm256_testz_si256(s8, alpha_mask))
+                {
+                    // all transparent
+                    continue;
+                }
+
+                store_8(blend_pm_8<M>(premultiply_8(s8), load_8(d + i)), d + i);
+            }
+
+        #endif
+
+            for (; i < len; ++i)
+            {
+                blend<M>(s[i], d + i);
+            }
+        }
+    }
+
+
+    template <BlendMode M>
+    static void blend_span(SpanView<PixelPM> const& src, SpanView<Pixel> const& dst)
+    {
+        if constexpr (M == BlendMode::Alpha)
+        {
+            alpha_blend_span(src, dst);
+        }
+        else
+        {
+            auto s = src.data;
+            auto d = dst.data;
+            auto len = dst.length;
+
+            u32 i = 0;
+
+        #ifdef IMAGE_SIMD_256
+
+            constexpr u32 N = N_SIMD_PIXELS;
+
+            for (; i + N <= len; i += N)
+            {
+                auto s8 = load_8(s + i);
+
+                if (_mm256_testz_si256(s8, s8))
+                {
+                    // nothing to blend
+                    continue;
+                }
+
+                store_8(blend_pm_8<M>(s8, load_8(d + i)), d + i);
+            }
+
+        #endif
+
+            for (; i < len; ++i)
+            {
+                blend<M>(s[i], d + i);
+            }
+        }
+    }
+
+
+    template <BlendMode M>
+    static void blend_fill_span(SpanView<Pixel> const& dst, Pixel color)
+    {
+        if constexpr (M == BlendMode::Alpha)
+        {
+            alpha_blend_fill_span(dst, color);
+        }
+        else
+        {
+            if (!color.alpha)
+            {
+                return;
+            }
+
+            auto d = dst.data;
+            auto len = dst.length;
+
+            u32 i = 0;
+
+        #ifdef IMAGE_SIMD_256
+
+            constexpr u32 N = N_SIMD_PIXELS;
+
+            auto c8 = premultiply_8(_mm256_set1_epi32((int)as_u32(color)));
+
+            for (; i + N <= len; i += N)
+            {
+                store_8(blend_pm_8<M>(c8, load_8(d + i)), d + i);
+            }
+
+        #endif
+
+            auto const pm = to_premultiplied(color);
+
+            for (; i < len; ++i)
+            {
+                blend<M>(pm, d + i);
+            }
+        }
+    }
+}
+
+
+/* fill */
+
+namespace image
+{
+    template <typename T>
+    static void fill_span_if(SpanView<T> const& dst, u8 value, fn<bool(T)> const& pred)
+    {
+        T* d = dst.data;
+        for (u32 i = 0; i < dst.length; ++i)
+		{
+			d[i] = pred(d[i]) ? value : d[i];
+		}
+    }
+
+
+    void fill(ImageView const& view, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        auto const fill_band = [&](ImageView const& band)
+        {
+            sp::fill_32(to_span(band), color);
+        };
+
+        exe::for_each_row_band(view, fill_band);
+    }
+
+
+    void fill(SubView const& view, Pixel color)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        auto const fill_band = [&](SubView const& band)
+        {
+            for (u32 y = 0; y < band.height; y++)
+            {
+                sp::fill_32(row_span(band, y), color);
+            }
+        };
+
+        exe::for_each_row_band(view, fill_band);
+    }
+
+
+    void fill(GrayView const& view, u8 gray)
+    {
+        assert(view.matrix_data_);
+
+        auto const fill_band = [&](GrayView const& band)
+        {
+            sp::fill_8(to_span(band), gray);
+        };
+
+        exe::for_each_row_band(view, fill_band);
+    }
+
+
+    void fill(GraySubView const& view, u8 gray)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        auto const fill_band = [&](GraySubView const& band)
+        {
+            for (u32 y = 0; y < band.height; y++)
+            {
+                sp::fill_8(row_span(band, y), gray);
+            }
+        };
+
+        exe::for_each_row_band(view, fill_band);
+    }
+
+
+    void fill_if(GraySubView const& view, u8 gray, fn<bool(u8)> const& pred)
+    {
+        assert(view.matrix_data_);
+
+        for (u32 y = 0; y < view.height; y++)
+        {
+            fill_span_if(row_span(view, y), gray, pred);
+        }
+    }
+
+
+    void fill_blend(SubView const& view, Pixel color)
+    {
+        for (u32 y = 0; y < view.height; y++)
+        {
+            alpha_blend_fill_span(row_span(view, y), color);
+        }
+    }
+
+
+    void fill_blend(SubView const& view, Pixel color, BlendMode mode)
+    {
+        assert(view.matrix_data_);
+
+        blend_mode_dispatch(mode, [&](auto m)
+        {
+            exe::for_each_row_band(view, [&](SubView const& band)
+            {
+                for (u32 y = 0; y < band.height; y++)
+                {
+                    blend_fill_span<decltype(m)::value>(row_span(band, y), color);
+                }
+            });
+        });
+    }
+
+
+    void fill_row(SubView const& view, u32 y, Pixel color)
+    {
+        sp::fill_32(row_span(view, y), color);
+    }
+
+
+    void fill_row_blend(SubView const& view, u32 y, Pixel color)
+    {
+        alpha_blend_fill_span(row_span(view, y), color);
+    }
+}
+
+
+/* copy */
+
+namespace image
+{
+    template <class VIEW_S, class VIEW_D>
+    static void copy_view(VIEW_S const& src, VIEW_D const& dst)
+    {
+        auto const copy_band = [](VIEW_S const& s, VIEW_D const& d)
+        {
+            sp::copy(to_span(s), to_span(d));
+        };
+
+        exe::for_each_row_band(src, dst, copy_band);
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void copy_sub_view(VIEW_S const& src, VIEW_D const& dst)
+    {
+        auto const copy_band = [](VIEW_S const& s, VIEW_D const& d)
+        {
+            for (u32 y = 0; y < s.height; y++)
+            {
+                sp::copy(row_span(s, y), row_span(d, y));
+            }
+        };
+
+        exe::for_each_row_band(src, dst, copy_band);
+    }
+
+
+    template <typename V_SRC, typename V_DST>
+    static void copy_blend_sub_view(V_SRC const& src, V_DST const& dst)
+    {
+        for (u32 y = 0; y < src.height; y++)
+        {
+            alpha_blend_span(row_span(src, y), row_span(dst, y));
+        }
+    }
+
+
+    template <class V_SRC, class V_DST>
+    static void copy_blend_bands(V_SRC const& src, V_DST const& dst, BlendMode mode)
+    {
+        blend_mode_dispatch(mode, [&](auto m)
+        {
+            exe::for_each_row_band(src, dst, [](auto const& s, auto const& d)
+            {
+                for (u32 y = 0; y < s.height; y++)
+                {
+                    blend_span<decltype(m)::value>(row_span(s, y), row_span(d, y));
+                }
+            });
+        });
+    }
+
+
+    void copy(ImageView const& src, ImageView const& dst)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
         assert(dst.width == src.width);
         assert(dst.height == src.height);
 
-        transform_sub_view(src, dst, func);
+        copy_view(src, dst);
+    }    
+
+
+    void copy(ImageView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_sub_view(src, dst);
+    }
+
+
+    void copy(SubView const& src, ImageView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_sub_view(src, dst);
+    }
+
+
+    void copy(SubView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_sub_view(src, dst);
+    }
+
+
+    void copy_blend(ImageView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_sub_view(src, dst);
+    }
+
+
+    void copy_blend(SubView const& src, ImageView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_sub_view(src, dst);
+    }
+
+
+    void copy_blend(SubView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_sub_view(src, dst);
+    }
+
+
+    void copy_blend(ImageView const& src, SubView const& dst, u8 alpha)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        constexpr auto scale = 1.0f / 255.0f;
+
+        f32 a = 1.0f;
+
+        switch (alpha)
+        {
+        case 0: 
+            return;
+
+        case 255:
+            copy(src, dst);
+            return;
+
+        case 127:
+        case 128:
+            a = 0.5f;
+            break;
+
+        default: 
+            a = alpha * scale;
+            break;
+        }
+
+        for (u32 y = 0; y < src.height; y++)
+        {
+            alpha_blend_span(row_span(src, y), row_span(dst, y), a);
+        }
+    }
+
+
+    void copy_blend(ImageViewPM const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_sub_view(src, dst);
+    }
+
+
+    void copy_blend(SubViewPM const& src, ImageView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_sub_view(src, dst);
+    }
+
+
+    void copy_blend(SubViewPM const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_sub_view(src, dst);
+    }
+
+
+    void copy_blend(ImageView const& src, SubView const& dst, BlendMode mode)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_bands(src, dst, mode);
+    }
+
+
+    void copy_blend(SubView const& src, ImageView const& dst, BlendMode mode)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_bands(src, dst, mode);
+    }
+
+
+    void copy_blend(SubView const& src, SubView const& dst, BlendMode mode)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_bands(src, dst, mode);
+    }
+
+
+    void copy_blend(ImageViewPM const& src, SubView const& dst, BlendMode mode)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_bands(src, dst, mode);
+    }
+
+
+    void copy_blend(SubViewPM const& src, ImageView const& dst, BlendMode mode)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_bands(src, dst, mode);
+    }
+
+
+    void copy_blend(SubViewPM const& src, SubView const& dst, BlendMode mode)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        copy_blend_bands(src, dst, mode);
+    }
+}
+
+
+/* premultiply */
+
+namespace image
+{
+    static void premultiply_span(SpanView<Pixel> const& src, SpanView<PixelPM> const& dst)
+    {
+        auto s = src.data;
+        auto d = dst.data;
+        auto len = dst.length;
+
+        u32 i = 0;
+
+    #ifdef IMAGE_SIMD_256
+
+        constexpr u32 N = N_SIMD_PIXELS;
+
+        for (; i + N <= len; i += N)
+        {
+            store_8(premultiply_8(load_8(s + i)), d + i);
+        }
+
+    #endif
+
+        for (; i < len; ++i)
+        {
+            d[i] = to_premultiplied(s[i]);
+        }
+    }
+
+
+    void premultiply(ImageView const& src, ImageViewPM const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        auto const premultiply_band = [](ImageView const& s, ImageViewPM const& d)
+        {
+            premultiply_span(to_span(s), to_span(d));
+        };
+
+        exe::for_each_row_band(src, dst, premultiply_band);
+    }
+
+
+    ImageViewPM premultiply(ImageView const& view)
+    {
+        ImageViewPM pm{};
+        pm.matrix_data_ = (PixelPM*)view.matrix_data_;
+        pm.width = view.width;
+        pm.height = view.height;
+
+        premultiply(view, pm);
+
+        return pm;
+    }
+}
+
+
+/* for_each_pixel */
+
+namespace image
+{   
+    template <typename T>
+    static inline void for_each_in_span(SpanView<T> const& span, fn<void(T)> const& func)
+    {
+        for (u32 i = 0; i < span.length; i++)
+        {
+            func(span.data[i]);
+        }
+    }
+
+
+    void for_each_pixel(ImageView const& view, fn<void(Pixel)> const& func)
+    {
+        assert(view.matrix_data_);
+
+        for_each_in_span(to_span(view), func);
+    }
+
+
+    void for_each_pixel(SubView const& view, fn<void(Pixel)> const& func)
+    {
+        assert(view.matrix_data_);
+
+        for (u32 y = 0; y < view.height; y++)
+        {
+            for_each_in_span(row_span(view, y), func);
+        }
+    }
+}
+
+
+/* for_each_xy */
+
+namespace image
+{
+    template <class VIEW, class FN>
+    static void for_each_xy_write(VIEW const& view, FN const& xy_func)
+    {
+        for (u32 y = 0; y < view.height; ++y)
+        {
+            auto d = row_begin(view, y);
+			for (u32 x = 0; x < view.width; ++x)
+            {
+                d[x] = xy_func(x, y);
+            }
+        }
+    }
+
+
+    template <class VIEW, class FN>
+    static void for_each_xy_exe(VIEW const& view, FN const& xy_func)
+    {
+        for (u32 y = 0; y < view.height; ++y)
+        {
+			for (u32 x = 0; x < view.width; ++x)
+            {
+                xy_func(x, y);
+            }
+        }
+    }
+
+
+    void for_each_xy(ImageView const& view, fn<Pixel(u32 x, u32 y)> const& xy_func)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+        
+        for_each_xy_write(view, xy_func);
+    }
+
+
+    void for_each_xy(SubView const& view, fn<Pixel(u32 x, u32 y)> const& xy_func)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+        
+        for_each_xy_write(view, xy_func);
+    }
+
+
+    void for_each_xy(ImageView const& view, fn<void(u32 x, u32 y)> const& xy_func)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+        
+        for_each_xy_exe(view, xy_func);
+    }
+
+
+    void for_each_xy(GrayView const& view, fn<u8(u32 x, u32 y)> const& xy_func)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+        
+        for_each_xy_write(view, xy_func);
+    }
+}
+
+
+/* transform static */
+
+namespace image
+{
+    template <typename P_SRC, typename P_DST>
+    static void transform_span(SpanView<P_SRC> const& src, SpanView<P_DST> const& dst, fn<P_DST(P_SRC, P_DST)> const& func)
+    {
+        auto s = src.data;
+        auto d = dst.data;
+
+        for (u32 i = 0; i < src.length; i++)
+        {
+            d[i] = func(s[i], d[i]);
+        }
+    }
+    
+
+    template <typename P_SRC, typename P_DST>
+    static void transform_span(SpanView<P_SRC> const& src, SpanView<P_DST> const& dst, fn<P_DST(P_SRC)> const& func)
+    {
+        auto s = src.data;
+        auto d = dst.data;
+
+        for (u32 i = 0; i < src.length; i++)
+        {
+            d[i] = func(s[i]);
+        }
+    }
+
+
+    template <class V_SRC, class V_DST, class FUNC>
+    static void transform_view(V_SRC const& src, V_DST const& dst, FUNC const& func)
+    {
+        auto const transform_band = [&](V_SRC const& s, V_DST const& d)
+        {
+            transform_span(to_span(s), to_span(d), func);
+        };
+
+        exe::for_each_row_band(src, dst, transform_band);
+    }
+
+
+    template <class V_SRC, class V_DST, class FUNC>
+    static void transform_sub_view(V_SRC const& src, V_DST const& dst, FUNC const& func)
+    {
+        auto const transform_band = [&](V_SRC const& s, V_DST const& d)
+        {
+            for (u32 y = 0; y < s.height; y++)
+            {
+                transform_span(row_span(s, y), row_span(d, y), func);
+            }
+        };
+
+        exe::for_each_row_band(src, dst, transform_band);
+    }
+
+}
+
+
+/* transform api */
+
+namespace image
+{   
+    
+    void transform(ImageView const& src, SubView const& dst, fn<Pixel(Pixel, Pixel)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        transform_sub_view(src, dst, func);
+    }
+
+
+    void transform(SubView const& src, SubView const& dst, fn<Pixel(Pixel, Pixel)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        transform_sub_view(src, dst, func);
+    }
+
+
+    void transform(GrayView const& src, SubView const& dst, fn<Pixel(u8, Pixel)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        transform_sub_view(src, dst, func);
+    }
+
+
+    void transform(GraySubView const& src, SubView const& dst, fn<Pixel(u8, Pixel)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        transform_sub_view(src, dst, func);
+    }
+
+
+    void transform(ImageView const& src, GrayView const& dst, fn<u8(Pixel)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        transform_view(src, dst, func);
+    }
+
+
+    void transform(ImageView const& src, GraySubView const& dst, fn<u8(Pixel)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        transform_sub_view(src, dst, func);
+    }    
+
+
+    void transform(GrayView const& src, ImageView const& dst, fn<Pixel(u8)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        transform_view(src, dst, func);
+    }
+
+
+    void transform(GrayView const& src, SubView const& dst, fn<Pixel(u8)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        transform_sub_view(src, dst, func);
+    }
+
+
+    void transform(GraySubView const& src, ImageView const& dst, fn<Pixel(u8)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        transform_sub_view(src, dst, func);
+    }
+
+
+    void transform(GraySubView const& src, SubView const& dst, fn<Pixel(u8)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        transform_sub_view(src, dst, func);
+    }
+
+
+    void transform_scale_up(GraySubView const& src, SubView const& dst, u32 scale, fn<Pixel(u8, Pixel)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width * scale);
+        assert(dst.height == src.height * scale);
+
+        for (u32 src_y = 0; src_y < src.height; src_y++)
+        {
+            auto s = row_begin(src, src_y);
+
+            for (u32 src_x = 0; src_x < src.width; src_x++)
+            {
+                auto const src_value = s[src_x];
+
+                auto dst_y = src_y * scale;
+                for (u32 offset_y = 0; offset_y < scale; offset_y++, dst_y++)
+                {
+                    auto d = row_begin(dst, dst_y);
+
+                    auto dst_x = src_x * scale;
+                    for (u32 offset_x = 0; offset_x < scale; offset_x++, dst_x++)
+                    {
+                        d[dst_x] = func(src_value, d[dst_x]);
+                    }                    
+                }
+            }
+        }
+    }
+
+
+    void transform_scale_up(ImageView const& src, GrayView const& dst, u32 scale, fn<u8(Pixel)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width * scale);
+        assert(dst.height == src.height * scale);
+
+        for (u32 src_y = 0; src_y < src.height; src_y++)
+        {
+            auto s = row_begin(src, src_y);
+
+            for (u32 src_x = 0; src_x < src.width; src_x++)
+            {
+                auto const value = func(s[src_x]);
+
+                auto dst_y = src_y * scale;
+                for (u32 offset_y = 0; offset_y < scale; offset_y++, dst_y++)
+                {
+                    auto d = row_begin(dst, dst_y);
+
+                    auto dst_x = src_x * scale;
+                    for (u32 offset_x = 0; offset_x < scale; offset_x++, dst_x++)
+                    {
+                        d[dst_x] = value;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+/* mask rle */
+
+namespace image
+{
+    template <class FUNC>
+    static void for_each_mask_run(SpanView<u8> const& row, FUNC const& func)
+    {
+        auto s = row.data;
+        auto len = row.length;
+
+        u32 x = 0;
+        while (x < len)
+        {
+            auto value = s[x];
+            auto x_begin = x;
+
+            for (++x; x < len && s[x] == value; ++x)
+            { }
+
+            if (value)
+            {
+                func(x_begin, x, value);
+            }
+        }
+    }
+
+
+    template <class VIEW, class FUNC>
+    static void mask_rle_rows(MaskRLE const& mask, Rect2Du32 const& range, VIEW const& dst, FUNC const& run_func)
+    {
+        auto const x_begin = range.x_begin;
+        auto const x_end = range.x_end;
+
+        auto const runs = mask.runs.data_;
+        auto const offsets = mask.row_offsets.data_;
+
+        exe::for_each_band(dst.height, [&](u32 y_begin, u32 y_end)
+        {
+            for (u32 y = y_begin; y < y_end; y++)
+            {
+                auto my = range.y_begin + y;
+
+                // runs are sorted, skip to the first one ending past x_begin
+                auto i_begin = offsets[my];
+                auto i_end = offsets[my + 1];
+                while (i_begin < i_end)
+                {
+                    auto mid = (i_begin + i_end) / 2;
+                    if (runs[mid].x_end <= x_begin)
+                    {
+                        i_begin = mid + 1;
+                    }
+                    else
+                    {
+                        i_end = mid;
+                    }
+                }
+
+                for (u32 i = i_begin; i < offsets[my + 1]; i++)
+                {
+                    auto const& run = runs[i];
+                    if (run.x_begin >= x_end)
+                    {
+                        break;
+                    }
+
+                    auto rx_begin = num::max(run.x_begin, x_begin);
+                    auto rx_end = num::min(run.x_end, x_end);
+                    if (rx_begin < rx_end)
+                    {
+                        run_func(run.value, sub_span(dst, y, rx_begin - x_begin, rx_end - x_begin));
+                    }
+                }
+            }
+        });
+    }
+
+
+    bool create_mask_rle(MaskRLE& rle, GrayView const& mask)
+    {
+        assert(mask.matrix_data_);
+        assert(mask.width);
+        assert(mask.height);
+
+        u32 n_runs = 0;
+        for (u32 y = 0; y < mask.height; y++)
+        {
+            for_each_mask_run(row_span(mask, y), [&](u32, u32, u8) { n_runs++; });
+        }
+
+        if (!mb::create_buffer(rle.row_offsets, mask.height + 1, "mask_rle rows"))
+        {
+            return false;
+        }
+
+        // a mask with no runs still gets a valid buffer
+        if (!mb::create_buffer(rle.runs, num::max(n_runs, 1u), "mask_rle runs"))
+        {
+            destroy_mask_rle(rle);
+            return false;
+        }
+
+        rle.width = mask.width;
+        rle.height = mask.height;
+
+        auto offsets = rle.row_offsets.data_;
+        auto runs = rle.runs.data_;
+
+        u32 i = 0;
+        for (u32 y = 0; y < mask.height; y++)
+        {
+            offsets[y] = i;
+            for_each_mask_run(row_span(mask, y), [&](u32 x_begin, u32 x_end, u8 value)
+            {
+                runs[i++] = { x_begin, x_end, value };
+            });
+        }
+
+        offsets[mask.height] = i;
+        rle.runs.size_ = i;
+
+        return true;
+    }
+
+
+    void destroy_mask_rle(MaskRLE& rle)
+    {
+        mb::destroy_buffer(rle.row_offsets);
+        mb::destroy_buffer(rle.runs);
+
+        rle.width = 0;
+        rle.height = 0;
+    }
+
+
+    void fill(MaskRLE const& mask, SubView const& dst, Pixel color)
+    {
+        fill(mask, make_rect(mask.width, mask.height), dst, color);
+    }
+
+
+    void fill(MaskRLE const& mask, Rect2Du32 const& range, SubView const& dst, Pixel color)
+    {
+        assert(mask.row_offsets.data_);
+        assert(dst.matrix_data_);
+        assert(range.x_end <= mask.width);
+        assert(range.y_end <= mask.height);
+        assert(dst.width == range.x_end - range.x_begin);
+        assert(dst.height == range.y_end - range.y_begin);
+
+        mask_rle_rows(mask, range, dst, [&](u8, SpanView<Pixel> const& d)
+        {
+            sp::fill_32(d, color);
+        });
+    }
+
+
+    void transform(MaskRLE const& mask, SubView const& dst, fn<Pixel(u8)> const& func)
+    {
+        transform(mask, make_rect(mask.width, mask.height), dst, func);
+    }
+
+
+    void transform(MaskRLE const& mask, Rect2Du32 const& range, SubView const& dst, fn<Pixel(u8)> const& func)
+    {
+        assert(mask.row_offsets.data_);
+        assert(dst.matrix_data_);
+        assert(range.x_end <= mask.width);
+        assert(range.y_end <= mask.height);
+        assert(dst.width == range.x_end - range.x_begin);
+        assert(dst.height == range.y_end - range.y_begin);
+
+        mask_rle_rows(mask, range, dst, [&](u8 value, SpanView<Pixel> const& d)
+        {
+            sp::fill_32(d, func(value));
+        });
+    }
+
+
+    void fill(MaskRLE const& mask, Rect2Du32 const& range, GraySubView const& dst, u8 gray)
+    {
+        assert(mask.row_offsets.data_);
+        assert(dst.matrix_data_);
+        assert(range.x_end <= mask.width);
+        assert(range.y_end <= mask.height);
+        assert(dst.width == range.x_end - range.x_begin);
+        assert(dst.height == range.y_end - range.y_begin);
+
+        mask_rle_rows(mask, range, dst, [&](u8, SpanView<u8> const& d)
+        {
+            sp::fill_8(d, gray);
+        });
+    }
+
+
+    void transform(MaskRLE const& mask, Rect2Du32 const& range, GraySubView const& dst, fn<u8(u8)> const& func)
+    {
+        assert(mask.row_offsets.data_);
+        assert(dst.matrix_data_);
+        assert(range.x_end <= mask.width);
+        assert(range.y_end <= mask.height);
+        assert(dst.width == range.x_end - range.x_begin);
+        assert(dst.height == range.y_end - range.y_begin);
+
+        mask_rle_rows(mask, range, dst, [&](u8 value, SpanView<u8> const& d)
+        {
+            sp::fill_8(d, func(value));
+        });
+    }
+}
+
+
+/* circle unsafe */
+
+namespace image
+{
+namespace draw
+{
+    template <class VIEW, typename P>
+    static void circle_outline_unsafe(VIEW const& view, Point2Di32 center, u32 radius, P color)
+    {
+        static_assert(sizeof(P) == sizeof(view.matrix_data_[0]));
+
+        i32 const cx = center.x;
+        i32 const cy = center.y;
+
+        assert(view.width >= 2 * radius);
+        assert(view.height >= 2 * radius);
+        assert(cx >= radius);
+        assert(cx <= view.width - radius);
+        assert(cy >= radius);
+        assert(cy <= view.height - radius);
+
+        i32 ox = radius;
+        i32 oy = 0;
+        i32 dy = -2;
+        i32 dx = 4 * (radius - 1);
+        i32 D = 2 * radius - 1;
+        i32 mask = 0;
+
+        i32 y = 0;
+        i32 x_min = 0;
+        i32 x_max = 0;
+
+        auto row = row_span(view, 0);
+
+        auto const write = [&]()
+        {
+            row = row_span(view, y);
+            row.data[x_min] = row.data[x_max] = color;
+        };
+
+        while (oy <= ox)
+        {         
+            y = cy - oy;
+            x_min = cx - ox;
+            x_max = cx + ox;
+            write();
+
+            y = cy + oy;
+            write();
+
+            y = cy - ox;
+            x_min = cx - oy;
+            x_max = cx + oy;
+            write();
+
+            y = cy + ox;
+            write();
+
+            D += dy;
+            dy -= 4;
+            ++oy;
+
+            mask = (D >> 31);
+            D += dx & mask;
+            dx -= 4 & mask;
+            ox += mask;
+        }
+    }
+}
+}
+
+
+/* circle */
+
+namespace image
+{
+namespace draw
+{
+    template <class VIEW, typename P>
+    static void circle_outline_safe(VIEW const& view, Point2Di32 center, u32 radius, P color)
+    {
+        static_assert(sizeof(P) == sizeof(view.matrix_data_[0]));
+
+        constexpr i32 oD = 0; // offset to correct diameter
+
+        i32 const cx = center.x;
+        i32 const cy = center.y;
+
+        i32 const width = view.width;
+        i32 const height = view.height;
+
+        i32 ox = radius;
+        i32 oy = 0;
+        i32 dy = -2;
+        i32 dx = 4 * (radius - 1);
+        i32 D = 2 * radius - 1;
+        i32 mask = 0;
+
+        i32 y = 0;
+        i32 x_min = 0;
+        i32 x_max = 0;       
+
+        auto row = row_span(view, 0);
+
+        auto const write_at_x = [&](i32 x)
+        {
+            if (x >= 0 && x < width)
+            {
+                row.data[x] = color;
+            }
+        };
+
+        auto const write = [&]()
+        {
+            if (y >= 0 & y < height)
+            {
+                row = row_span(view, y);
+                write_at_x(x_min);
+                write_at_x(x_max);
+            }
+        };
+
+        while (oy <= ox)
+        {         
+            y = cy - oy;
+            x_min = cx - ox;
+            x_max = cx + ox + oD;
+            write();
+
+            y = cy + oy + oD;
+            write();
+
+            y = cy - ox;
+            x_min = cx - oy;
+            x_max = cx + oy + oD;
+            write();
+
+            y = cy + ox + oD;
+            write();
+
+            D += dy;
+            dy -= 4;
+            ++oy;
+
+            mask = (D >> 31);
+            D += dx & mask;
+            dx -= 4 & mask;
+            ox += mask;
+        }
+    }
+
+
+    template <class VIEW, typename P>
+    static void circle_fill_spans(VIEW const& view, Point2Di32 center, u32 radius, P color)
+    {
+        static_assert(sizeof(P) == sizeof(view.matrix_data_[0]));
+
+        i32 const cx = center.x;
+        i32 const cy = center.y;
+        i32 const r = (i32)radius;
+
+        i32 const width = view.width;
+        i32 const height = view.height;
+
+        if (cx + r < 0 || cx - r >= width || cy + r < 0 || cy - r >= height)
+        {
+            return;
+        }
+
+        // clip against the view once, spans are only clamped when the circle crosses a side
+        bool const clip_x = cx - r < 0 || cx + r >= width;
+
+        auto const write_row = [&](i32 y, i32 half)
+        {
+            if (y < 0 || y >= height)
+            {
+                return;
+            }
+
+            i32 x_begin = cx - half;
+            i32 x_end = cx + half + 1;
+
+            if (clip_x)
+            {
+                x_begin = num::max(x_begin, 0);
+                x_end = num::min(x_end, width);
+                if (x_begin >= x_end)
+                {
+                    return;
+                }
+            }
+
+            sp::fill(sub_span(view, y, x_begin, x_end), color);
+        };
+
+        auto const write = [&](i32 oy, i32 half)
+        {
+            write_row(cy - oy, half);
+            if (oy)
+            {
+                write_row(cy + oy, half);
+            }
+        };
+
+        // midpoint circle, each row pair is written once at its final width
+        i32 ox = r;
+        i32 oy = 0;
+        i32 dy = -2;
+        i32 dx = 4 * (r - 1);
+        i32 D = 2 * r - 1;
+        i32 mask = 0;
+
+        while (oy <= ox)
+        {
+            write(oy, ox);
+
+            auto ox_last = ox;
+            auto oy_last = oy;
+
+            D += dy;
+            dy -= 4;
+            ++oy;
+
+            mask = (D >> 31);
+            D += dx & mask;
+            dx -= 4 & mask;
+            ox += mask;
+
+            // rows cy +/- ox are widest on the last step before ox changes
+            // rows with ox <= oy are covered by the wider spans above
+            if ((ox != ox_last || oy > ox) && ox_last > oy_last)
+            {
+                write(ox_last, oy_last);
+            }
+        }
+    }
+
+
+    void circle_outline(ImageView const& view, Point2Di32 center, u32 radius, Pixel color)
+    {
+        circle_outline_safe(view, center, radius, color);
+    }
+
+
+    void circle_outline(SubView const& view, Point2Di32 center, u32 radius, Pixel color)
+    {
+        circle_outline_safe(view, center, radius, color);
+    }
+
+
+    void circle_fill(ImageView const& view, Point2Di32 center, u32 radius, Pixel color)
+    {
+        circle_fill_spans(view, center, radius, color);
+    }
+
+
+    void circle_fill(SubView const& view, Point2Di32 center, u32 radius, Pixel color)
+    {
+        circle_fill_spans(view, center, radius, color);
+    }
+
+
+    void circle_outline(GrayView const& view, Point2Di32 center, u32 radius, u8 gray)
+    {
+        circle_outline_safe(view, center, radius, gray);
+    }
+
+
+    void circle_outline(GraySubView const& view, Point2Di32 center, u32 radius, u8 gray)
+    {
+        circle_outline_safe(view, center, radius, gray);
+    }
+
+
+    void circle_fill(GrayView const& view, Point2Di32 center, u32 radius, u8 gray)
+    {
+        circle_fill_spans(view, center, radius, gray);
+    }
+
+
+    void circle_fill(GraySubView const& view, Point2Di32 center, u32 radius, u8 gray)
+    {
+        circle_fill_spans(view, center, radius, gray);
+    }
+}
+}
+
+
+/* rotate rows */
+
+namespace image
+{
+    // 16.16 fixed point
+    constexpr i32 FX_SHIFT = 16;
+    constexpr i32 FX_ONE = 1 << FX_SHIFT;
+    constexpr i32 FX_HALF = FX_ONE / 2;
+
+
+    static inline i64 div_floor(i64 n, i64 d)
+    {
+        // d > 0
+        auto q = n / d;
+        return (n % d < 0) ? q - 1 : q;
+    }
+
+
+    static inline i64 div_ceil(i64 n, i64 d)
+    {
+        return -div_floor(-n, d);
+    }
+
+
+    // limit [x_begin, x_end) to where lo <= f0 + x * df < hi
+    static inline void clip_linear(i64 f0, i64 df, i64 lo, i64 hi, i64& x_begin, i64& x_end)
+    {
+        if (df > 0)
+        {
+            x_begin = num::max(x_begin, div_ceil(lo - f0, df));
+            x_end = num::min(x_end, div_ceil(hi - f0, df));
+        }
+        else if (df < 0)
+        {
+            x_begin = num::max(x_begin, div_floor(f0 - hi, -df) + 1);
+            x_end = num::min(x_end, div_floor(f0 - lo, -df) + 1);
+        }
+        else if (f0 < lo || f0 >= hi)
+        {
+            x_end = x_begin;
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D, class FUNC>
+    static void rotate_rows(VIEW_S const& src, VIEW_D const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, f32 cos, f32 sin, FUNC const& func)
+    {
+        // source position of dst (x, y)
+        // sx = spx + (x - dpx) * cos + (y - dpy) * sin
+        // sy = spy - (x - dpx) * sin + (y - dpy) * cos
+        // sampled at the nearest pixel
+
+        assert(src.width < (1u << (31 - FX_SHIFT)) - 1);
+        assert(src.height < (1u << (31 - FX_SHIFT)) - 1);
+
+        i64 const c = num::round_to_signed<i64>(cos * FX_ONE);
+        i64 const s = num::round_to_signed<i64>(sin * FX_ONE);
+
+        // (sx + 1/2) >> 16 < width
+        i64 const sx_end = (i64)src.width * FX_ONE - FX_HALF;
+        i64 const sy_end = (i64)src.height * FX_ONE - FX_HALF;
+
+        i64 const spx = (i64)src_pivot.x * FX_ONE;
+        i64 const spy = (i64)src_pivot.y * FX_ONE;
+
+        i64 const dpx = dst_pivot.x;
+        i64 const dpy = dst_pivot.y;
+
+        for (u32 y = 0; y < dst.height; y++)
+        {
+            i64 const dy = (i64)y - dpy;
+
+            i64 const sx0 = spx - dpx * c + dy * s;
+            i64 const sy0 = spy + dpx * s + dy * c;
+
+            i64 x_begin = 0;
+            i64 x_end = dst.width;
+
+            clip_linear(sx0, c, 0, sx_end, x_begin, x_end);
+            clip_linear(sy0, -s, 0, sy_end, x_begin, x_end);
+
+            if (x_begin >= x_end)
+            {
+                continue;
+            }
+
+            // no bounds checks inside [x_begin, x_end)
+            auto sx = (i32)(sx0 + x_begin * c);
+            auto sy = (i32)(sy0 - x_begin * s);
+
+            auto const dsx = (i32)c;
+            auto const dsy = (i32)-s;
+
+            auto d = row_begin(dst, y);
+
+            for (auto x = (u32)x_begin; x < (u32)x_end; x++)
+            {
+                auto p = *xy_at(src, (u32)((sx + FX_HALF) >> FX_SHIFT), (u32)((sy + FX_HALF) >> FX_SHIFT));
+                func(p, d + x);
+
+                sx += dsx;
+                sy += dsy;
+            }
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D, class FUNC>
+    static void rotate_any(VIEW_S const& src, VIEW_D const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, f32 cos, f32 sin, FUNC const& func)
+    {
+        // each row is independent
+        exe::for_each_band(dst.height, [&](u32 y_begin, u32 y_end)
+        {
+            Point2Di32 dp = { dst_pivot.x, dst_pivot.y - (i32)y_begin };
+
+            rotate_rows(src, row_band(dst, y_begin, y_end), src_pivot, dp, cos, sin, func);
+        });
+    }
+}
+
+
+
+/* shapes */
+
+namespace image
+{
+namespace draw
+{
+    // 24.8 fixed point vertices, pixel (x, y) is covered when its center is inside the shape
+    constexpr i64 SUB_SHIFT = 8;
+    constexpr i64 SUB_ONE = 1 << SUB_SHIFT;
+    constexpr i64 SUB_HALF = SUB_ONE / 2;
+
+
+    static inline Point2Di64 to_sub_center(Point2Di32 p)
+    {
+        return { (i64)p.x * SUB_ONE + SUB_HALF, (i64)p.y * SUB_ONE + SUB_HALF };
+    }
+
+
+    static inline Point2Di64 to_sub_corner(Point2Di32 p)
+    {
+        return { (i64)p.x * SUB_ONE, (i64)p.y * SUB_ONE };
+    }
+
+
+    // first pixel column at or right of an edge, stepped exactly one row at a time
+    class EdgeStep
+    {
+    public:
+        i64 x = 0;
+        i64 r = 0;
+        i64 m = 1;
+
+        i64 dx = 0;
+        i64 dr = 0;
+    };
+
+
+    static EdgeStep make_edge_step(Point2Di64 a, Point2Di64 b, i64 row_y)
+    {
+        // a.y < b.y
+        // x(Y) = ceil((X(Y) - SUB_HALF) / SUB_ONE), X(Y) = a.x + (Y - a.y) * (b.x - a.x) / (b.y - a.y)
+        auto const d = b.y - a.y;
+
+        EdgeStep e{};
+        e.m = SUB_ONE * d;
+
+        auto n = (row_y - a.y) * (b.x - a.x) + (a.x - SUB_HALF) * d + e.m - 1;
+        e.x = div_floor(n, e.m);
+        e.r = n - e.x * e.m;
+
+        auto step = SUB_ONE * (b.x - a.x);
+        e.dx = div_floor(step, e.m);
+        e.dr = step - e.dx * e.m;
+
+        return e;
+    }
+
+
+    static inline void next_row(EdgeStep& e)
+    {
+        e.x += e.dx;
+        e.r += e.dr;
+        if (e.r >= e.m)
+        {
+            e.x++;
+            e.r -= e.m;
+        }
+    }
+
+
+    // one side of a convex polygon, walking from the top vertex in one direction
+    class PolygonChain
+    {
+    public:
+        Point2Di64 const* points = nullptr;
+        u32 count = 0;
+
+        u32 id = 0;
+        i32 dir = 1;
+        u32 n_steps = 0;
+
+        EdgeStep edge;
+    };
+
+
+    static bool find_chain_edge(PolygonChain& chain, i64 row_y)
+    {
+        auto const n = chain.count;
+
+        auto a = chain.points[chain.id];
+        auto b = chain.points[(chain.id + n + chain.dir) % n];
+
+        while (row_y >= b.y || a.y >= b.y)
+        {
+            if (++chain.n_steps >= n)
+            {
+                return false;
+            }
+
+            chain.id = (chain.id + n + chain.dir) % n;
+            a = b;
+            b = chain.points[(chain.id + n + chain.dir) % n];
+        }
+
+        chain.edge = make_edge_step(a, b, row_y);
+
+        return true;
+    }
+
+
+    template <class VIEW, class SPAN_FUNC>
+    static void convex_spans(VIEW const& view, Point2Di64 const* points, u32 count, SPAN_FUNC const& span_func)
+    {
+        if (count < 3)
+        {
+            return;
+        }
+
+        u32 top = 0;
+        i64 y_min = points[0].y;
+        i64 y_max = points[0].y;
+
+        for (u32 i = 1; i < count; i++)
+        {
+            if (points[i].y < y_min)
+            {
+                y_min = points[i].y;
+                top = i;
+            }
+
+            y_max = num::max(y_max, points[i].y);
+        }
+
+        // clip rows once, rows covered have y_min <= y * SUB_ONE + SUB_HALF < y_max
+        i64 const height = view.height;
+        i64 const width = view.width;
+
+        auto y_begin = num::max(div_ceil(y_min - SUB_HALF, SUB_ONE), (i64)0);
+        auto y_end = num::min(div_ceil(y_max - SUB_HALF, SUB_ONE), height);
+
+        if (y_begin >= y_end)
+        {
+            return;
+        }
+
+        PolygonChain left{ points, count, top, 1, 0, {} };
+        PolygonChain right{ points, count, top, -1, 0, {} };
+
+        auto row_y = y_begin * SUB_ONE + SUB_HALF;
+
+        if (!find_chain_edge(left, row_y) || !find_chain_edge(right, row_y))
+        {
+            return;
+        }
+
+        for (auto y = y_begin; y < y_end; y++, row_y += SUB_ONE)
+        {
+            if (row_y >= left.points[(left.id + count + left.dir) % count].y && !find_chain_edge(left, row_y))
+            {
+                return;
+            }
+
+            if (row_y >= right.points[(right.id + count + right.dir) % count].y && !find_chain_edge(right, row_y))
+            {
+                return;
+            }
+
+            auto x_begin = num::max(num::min(left.edge.x, right.edge.x), (i64)0);
+            auto x_end = num::min(num::max(left.edge.x, right.edge.x), width);
+
+            if (x_begin < x_end)
+            {
+                span_func(sub_span(view, (u32)y, (u32)x_begin, (u32)x_end));
+            }
+
+            next_row(left.edge);
+            next_row(right.edge);
+        }
+    }
+
+
+    template <class VIEW, class SPAN_FUNC>
+    static void line_spans(VIEW const& view, Point2Di32 p0, Point2Di32 p1, SPAN_FUNC const& span_func)
+    {
+        i64 const width = view.width;
+        i64 const height = view.height;
+
+        if (num::max(p0.x, p1.x) < 0 || num::min(p0.x, p1.x) >= width || 
+            num::max(p0.y, p1.y) < 0 || num::min(p0.y, p1.y) >= height)
+        {
+            return;
+        }
+
+        // step along the major axis u, the minor axis v moves at most one pixel per step
+        // step i is at (u0 + su * i, v0 + sv * q), q = floor((2 * i * dv + du) / (2 * du))
+
+        i64 const adx = p1.x > p0.x ? (i64)p1.x - p0.x : (i64)p0.x - p1.x;
+        i64 const ady = p1.y > p0.y ? (i64)p1.y - p0.y : (i64)p0.y - p1.y;
+
+        bool const x_major = adx >= ady;
+
+        i64 const u0 = x_major ? p0.x : p0.y;
+        i64 const v0 = x_major ? p0.y : p0.x;
+        i64 const sx = p1.x < p0.x ? -1 : 1;
+        i64 const sy = p1.y < p0.y ? -1 : 1;
+        i64 const su = x_major ? sx : sy;
+        i64 const sv = x_major ? sy : sx;
+        i64 const du = x_major ? adx : ady;
+        i64 const dv = x_major ? ady : adx;
+        i64 const u_size = x_major ? width : height;
+
+        // clip the steps to the view along u, v is checked per row
+        i64 i_begin = su > 0 ? -u0 : u0 - (u_size - 1);
+        i64 i_end = su > 0 ? u_size - u0 : u0 + 1;
+
+        i_begin = num::max(i_begin, (i64)0);
+        i_end = num::min(i_end, du + 1);
+
+        if (i_begin >= i_end)
+        {
+            return;
+        }
+
+        // q and the remainder at i_begin, estimated in f64 and corrected exactly
+        // 2 * i * dv can pass 2^64, the true remainder is small so wrapping arithmetic is exact
+        i64 const D = 2 * du;
+        i64 q = 0;
+        i64 rem = du;
+
+        if (du)
+        {
+            q = (i64)(((f64)i_begin * (f64)dv * 2.0 + (f64)du) / (f64)D);
+            rem = (i64)((u64)i_begin * (u64)(2 * dv) + (u64)du - (u64)q * (u64)D);
+
+            while (rem < 0)
+            {
+                rem += D;
+                --q;
+            }
+
+            while (rem >= D)
+            {
+                rem -= D;
+                ++q;
+            }
+        }
+
+        // consecutive pixels on the same row are written as one span
+        auto const write_run = [&](i64 y, i64 xa, i64 xb)
+        {
+            if (y < 0 || y >= height)
+            {
+                return;
+            }
+
+            auto x_begin = num::max(num::min(xa, xb), (i64)0);
+            auto x_end = num::min(num::max(xa, xb) + 1, width);
+
+            if (x_begin < x_end)
+            {
+                span_func(sub_span(view, (u32)y, (u32)x_begin, (u32)x_end));
+            }
+        };
+
+        auto u = u0 + su * i_begin;
+        auto v = v0 + sv * q;
+        auto u_run = u;
+
+        for (auto i = i_begin; i < i_end; i++)
+        {
+            auto u_last = u;
+            auto v_last = v;
+
+            u += su;
+            rem += 2 * dv;
+            if (rem >= D)
+            {
+                rem -= D;
+                v += sv;
+            }
+
+            if (!x_major)
+            {
+                write_run(u_last, v_last, v_last);
+            }
+            else if (v != v_last || i + 1 == i_end)
+            {
+                write_run(v_last, u_run, u_last);
+                u_run = u;
+            }
+        }
+    }
+
+
+    template <class VIEW, class SPAN_FUNC>
+    static void thick_line_spans(VIEW const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, SPAN_FUNC const& span_func)
+    {
+        assert(thickness);
+
+        if (thickness == 1)
+        {
+            line_spans(view, p0, p1, span_func);
+            return;
+        }
+
+        // quad around the segment between pixel centers, with flat ends
+        f32 dx = (f32)(p1.x - p0.x);
+        f32 dy = (f32)(p1.y - p0.y);
+        auto len = num::sqrt(dx * dx + dy * dy);
+
+        if (len == 0.0f)
+        {
+            dx = 1.0f;
+            len = 1.0f;
+        }
+
+        auto const scale = 0.5f * thickness * SUB_ONE / len;
+        i64 const nx = num::round_to_signed<i64>(-dy * scale);
+        i64 const ny = num::round_to_signed<i64>(dx * scale);
+
+        auto c0 = to_sub_center(p0);
+        auto c1 = to_sub_center(p1);
+
+        if (p0.x == p1.x && p0.y == p1.y)
+        {
+            c0.x -= ny;
+            c1.x += ny;
+        }
+
+        Point2Di64 quad[4] = {
+            { c0.x + nx, c0.y + ny },
+            { c1.x + nx, c1.y + ny },
+            { c1.x - nx, c1.y - ny },
+            { c0.x - nx, c0.y - ny },
+        };
+
+        convex_spans(view, quad, 4, span_func);
+    }
+
+
+    template <class VIEW, class SPAN_FUNC>
+    static void rect_outline_spans(VIEW const& view, Rect2Du32 const& rect, u32 thickness, SPAN_FUNC const& span_func)
+    {
+        assert(rect.x_begin <= rect.x_end);
+        assert(rect.y_begin <= rect.y_end);
+
+        auto const x_begin = rect.x_begin;
+        auto const x_end = num::min(rect.x_end, view.width);
+        auto const y_begin = rect.y_begin;
+        auto const y_end = num::min(rect.y_end, view.height);
+
+        if (x_begin >= x_end || y_begin >= y_end)
+        {
+            return;
+        }
+
+        auto const t = thickness;
+
+        // thickness past the center fills the rect
+        bool const solid = 2 * t >= rect.x_end - rect.x_begin || 2 * t >= rect.y_end - rect.y_begin;
+
+        auto const inner_y_begin = solid ? rect.y_end : rect.y_begin + t;
+        auto const inner_y_end = solid ? rect.y_end : rect.y_end - t;
+
+        auto const left_end = num::min(rect.x_begin + t, x_end);
+        auto const right_begin = rect.x_end - t;
+
+        for (u32 y = y_begin; y < y_end; y++)
+        {
+            if (y < inner_y_begin || y >= inner_y_end)
+            {
+                span_func(sub_span(view, y, x_begin, x_end));
+                continue;
+            }
+
+            span_func(sub_span(view, y, x_begin, left_end));
+
+            if (right_begin < x_end)
+            {
+                span_func(sub_span(view, y, right_begin, x_end));
+            }
+        }
+    }
+
+
+    template <class VIEW, class SPAN_FUNC>
+    static void triangle_spans(VIEW const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, SPAN_FUNC const& span_func)
+    {
+        Point2Di64 tri[3] = { to_sub_corner(p0), to_sub_corner(p1), to_sub_corner(p2) };
+
+        convex_spans(view, tri, 3, span_func);
+    }
+
+
+    template <class VIEW, class SPAN_FUNC>
+    static void polygon_spans(VIEW const& view, SpanView<Point2Di32> const& points, SPAN_FUNC const& span_func)
+    {
+        assert(points.length <= POLYGON_MAX_POINTS);
+
+        if (points.length > POLYGON_MAX_POINTS)
+        {
+            return;
+        }
+
+        Point2Di64 sub[POLYGON_MAX_POINTS];
+        auto const count = points.length;
+
+        for (u32 i = 0; i < count; i++)
+        {
+            sub[i] = to_sub_corner(points.data[i]);
+        }
+
+        convex_spans(view, sub, count, span_func);
+    }
+}
+}
+
+
+namespace image
+{
+namespace draw
+{
+    static auto fill_span_func(Pixel color)
+    {
+        return [color](SpanView<Pixel> const& span){ sp::fill_32(span, color); };
+    }
+
+
+    static auto blend_span_func(Pixel color)
+    {
+        return [color](SpanView<Pixel> const& span){ alpha_blend_fill_span(span, color); };
+    }
+
+
+    static auto fill_span_func(u8 gray)
+    {
+        return [gray](SpanView<u8> const& span){ sp::fill_8(span, gray); };
+    }
+
+
+    void line(ImageView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        thick_line_spans(view, p0, p1, thickness, fill_span_func(color));
+    }
+
+
+    void line(SubView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        thick_line_spans(view, p0, p1, thickness, fill_span_func(color));
+    }
+
+
+    void line_blend(ImageView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        thick_line_spans(view, p0, p1, thickness, blend_span_func(color));
+    }
+
+
+    void line_blend(SubView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        thick_line_spans(view, p0, p1, thickness, blend_span_func(color));
+    }
+
+
+    void rect_outline(ImageView const& view, Rect2Du32 const& rect, u32 thickness, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        rect_outline_spans(view, rect, thickness, fill_span_func(color));
+    }
+
+
+    void rect_outline(SubView const& view, Rect2Du32 const& rect, u32 thickness, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        rect_outline_spans(view, rect, thickness, fill_span_func(color));
+    }
+
+
+    void rect_outline_blend(ImageView const& view, Rect2Du32 const& rect, u32 thickness, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        rect_outline_spans(view, rect, thickness, blend_span_func(color));
+    }
+
+
+    void rect_outline_blend(SubView const& view, Rect2Du32 const& rect, u32 thickness, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        rect_outline_spans(view, rect, thickness, blend_span_func(color));
+    }
+
+
+    void triangle_fill(ImageView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        triangle_spans(view, p0, p1, p2, fill_span_func(color));
+    }
+
+
+    void triangle_fill(SubView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        triangle_spans(view, p0, p1, p2, fill_span_func(color));
+    }
+
+
+    void triangle_fill_blend(ImageView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        triangle_spans(view, p0, p1, p2, blend_span_func(color));
+    }
+
+
+    void triangle_fill_blend(SubView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        triangle_spans(view, p0, p1, p2, blend_span_func(color));
+    }
+
+
+    void polygon_fill(ImageView const& view, SpanView<Point2Di32> const& points, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        polygon_spans(view, points, fill_span_func(color));
+    }
+
+
+    void polygon_fill(SubView const& view, SpanView<Point2Di32> const& points, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        polygon_spans(view, points, fill_span_func(color));
+    }
+
+
+    void polygon_fill_blend(ImageView const& view, SpanView<Point2Di32> const& points, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        polygon_spans(view, points, blend_span_func(color));
+    }
+
+
+    void polygon_fill_blend(SubView const& view, SpanView<Point2Di32> const& points, Pixel color)
+    {
+        assert(view.matrix_data_);
+
+        polygon_spans(view, points, blend_span_func(color));
+    }
+
+
+    void line(GrayView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, u8 gray)
+    {
+        assert(view.matrix_data_);
+
+        thick_line_spans(view, p0, p1, thickness, fill_span_func(gray));
+    }
+
+
+    void line(GraySubView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, u8 gray)
+    {
+        assert(view.matrix_data_);
+
+        thick_line_spans(view, p0, p1, thickness, fill_span_func(gray));
+    }
+
+
+    void rect_outline(GrayView const& view, Rect2Du32 const& rect, u32 thickness, u8 gray)
+    {
+        assert(view.matrix_data_);
+
+        rect_outline_spans(view, rect, thickness, fill_span_func(gray));
+    }
+
+
+    void rect_outline(GraySubView const& view, Rect2Du32 const& rect, u32 thickness, u8 gray)
+    {
+        assert(view.matrix_data_);
+
+        rect_outline_spans(view, rect, thickness, fill_span_func(gray));
+    }
+
+
+    void triangle_fill(GrayView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, u8 gray)
+    {
+        assert(view.matrix_data_);
+
+        triangle_spans(view, p0, p1, p2, fill_span_func(gray));
+    }
+
+
+    void triangle_fill(GraySubView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, u8 gray)
+    {
+        assert(view.matrix_data_);
+
+        triangle_spans(view, p0, p1, p2, fill_span_func(gray));
+    }
+
+
+    void polygon_fill(GrayView const& view, SpanView<Point2Di32> const& points, u8 gray)
+    {
+        assert(view.matrix_data_);
+
+        polygon_spans(view, points, fill_span_func(gray));
+    }
+
+
+    void polygon_fill(GraySubView const& view, SpanView<Point2Di32> const& points, u8 gray)
+    {
+        assert(view.matrix_data_);
+
+        polygon_spans(view, points, fill_span_func(gray));
+    }
+}
+}
+
+
+/* rotate static */
+
+namespace image
+{
+#ifdef IMAGE_SIMD_256
+
+    static inline void transpose_8x8(__m256i (&r)[8])
+    {
+        auto t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+        auto t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+        auto t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+        auto t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+        auto t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+        auto t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+        auto t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+        auto t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+        auto u0 = _mm256_unpacklo_epi64(t0, t2);
+        auto u1 = _mm256_unpackhi_epi64(t0, t2);
+        auto u2 = _mm256_unpacklo_epi64(t1, t3);
+        auto u3 = _mm256_unpackhi_epi64(t1, t3);
+        auto u4 = _mm256_unpacklo_epi64(t4, t6);
+        auto u5 = _mm256_unpackhi_epi64(t4, t6);
+        auto u6 = _mm256_unpacklo_epi64(t5, t7);
+        auto u7 = _mm256_unpackhi_epi64(t5, t7);
+
+        r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+        r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+        r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+        r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+        r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+        r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+        r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+        r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+    }
+
+
+    static inline void transpose_8x8(Pixel* s, i64 s_stride, Pixel* d, i64 d_stride)
+    {
+        __m256i r[8];
+        for (u32 j = 0; j < 8; j++)
+        {
+            r[j] = load_8(s + j * s_stride);
+        }
+
+        transpose_8x8(r);
+
+        for (u32 j = 0; j < 8; j++)
+        {
+            store_8(r[j], d + j * d_stride);
+        }
+    }
+
+#endif
+
+
+    // d[i * d_stride + j] = s[j * s_stride + i], for i < height, j < width
+    static void transpose_block(Pixel* s, i64 s_stride, Pixel* d, i64 d_stride, u32 width, u32 height)
+    {
+        u32 i = 0;
+
+    #ifdef IMAGE_SIMD_256
+
+        for (; i + 8 <= height; i += 8)
+        {
+            u32 j = 0;
+            for (; j + 8 <= width; j += 8)
+            {
+                transpose_8x8(s + j * s_stride + i, s_stride, d + i * d_stride + j, d_stride);
+            }
+
+            for (; j < width; j++)
+            {
+                for (u32 k = i; k < i + 8; k++)
+                {
+                    d[k * d_stride + j] = s[j * s_stride + k];
+                }
+            }
+        }
+
+    #endif
+
+        for (; i < height; i++)
+        {
+            for (u32 j = 0; j < width; j++)
+            {
+                d[i * d_stride + j] = s[j * s_stride + i];
+            }
+        }
+    }
+
+
+    static void transpose(Pixel* s, i64 s_stride, Pixel* d, i64 d_stride, u32 width, u32 height)
+    {
+        // 64x64 blocks keep both the source and destination lines in L1
+        constexpr u32 B = 64;
+
+        for (u32 i = 0; i < height; i += B)
+        {
+            auto bh = num::min(B, height - i);
+            for (u32 j = 0; j < width; j += B)
+            {
+                auto bw = num::min(B, width - j);
+                transpose_block(s + j * s_stride + i, s_stride, d + i * d_stride + j, d_stride, bw, bh);
+            }
+        }
+    }
+
+
+    static void reverse_row(Pixel* s, Pixel* d, u32 len)
+    {
+        u32 i = 0;
+
+    #ifdef IMAGE_SIMD_256
+
+        constexpr u32 N = N_SIMD_PIXELS;
+
+        auto const rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+        for (; i + N <= len; i += N)
+        {
+            store_8(_mm256_permutevar8x32_epi32(load_8(s + len - N - i), rev), d + i);
+        }
+
+    #endif
+
+        for (; i < len; i++)
+        {
+            d[i] = s[len - 1 - i];
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void rotate_view_90(VIEW_S const& src, VIEW_D const& dst)
+    {
+        // dst (x, y) = src (y, dst.width - 1 - x), src rows are read bottom up
+        auto const s_stride = row_stride(src);
+
+        transpose(row_begin(src, dst.width - 1), -s_stride, row_begin(dst, 0), row_stride(dst), dst.width, dst.height);
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void rotate_view_180(VIEW_S const& src, VIEW_D const& dst)
+    {
+        auto const dw = dst.width;
+        auto const dh = dst.height;
+
+        for (u32 dy = 0; dy < dh; dy++)
+        {
+            reverse_row(row_begin(src, dh - 1 - dy), row_begin(dst, dy), dw);
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void rotate_view_270(VIEW_S const& src, VIEW_D const& dst)
+    {
+        // dst (x, y) = src (dst.height - 1 - y, x), dst rows are written bottom up
+        auto const d_stride = row_stride(dst);
+
+        transpose(row_begin(src, 0), row_stride(src), row_begin(dst, dst.height - 1), -d_stride, dst.width, dst.height);
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void rotate_view_any(VIEW_S const& src, VIEW_D const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, f32 cos, f32 sin)
+    {
+        rotate_any(src, dst, src_pivot, dst_pivot, cos, sin, [](auto s, auto d){ *d = s; });
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void rotate_view_any(VIEW_S const& src, VIEW_D const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot)
+    {
+        auto const cos = num::cos(rot);
+        auto const sin = num::sin(rot);
+
+        rotate_view_any(src, dst, src_pivot, dst_pivot, cos, sin);
+    }    
+}
+
+
+/* rotate bands */
+
+namespace image
+{
+    template <class VIEW_S, class VIEW_D>
+    static void rotate_bands_90(VIEW_S const& src, VIEW_D const& dst)
+    {
+        // dst rows [y_begin, y_end) read src columns [y_begin, y_end)
+        exe::for_each_band(dst.height, [&](u32 y_begin, u32 y_end)
+        {
+            rotate_view_90(column_band(src, y_begin, y_end), row_band(dst, y_begin, y_end));
+        });
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void rotate_bands_180(VIEW_S const& src, VIEW_D const& dst)
+    {
+        auto const h = dst.height;
+
+        exe::for_each_band(h, [&](u32 y_begin, u32 y_end)
+        {
+            rotate_view_180(row_band(src, h - y_end, h - y_begin), row_band(dst, y_begin, y_end));
+        });
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void rotate_bands_270(VIEW_S const& src, VIEW_D const& dst)
+    {
+        auto const h = dst.height;
+
+        exe::for_each_band(h, [&](u32 y_begin, u32 y_end)
+        {
+            rotate_view_270(column_band(src, h - y_end, h - y_begin), row_band(dst, y_begin, y_end));
+        });
+    }
+}
+
+
+/* rotate_blend static */
+
+namespace image
+{
+    template <BlendMode M, class VIEW_S, class VIEW_D>
+    static void rotate_blend_any(VIEW_S const& src, VIEW_D const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, f32 cos, f32 sin)
+    {
+        rotate_any(src, dst, src_pivot, dst_pivot, cos, sin, [](auto s, Pixel* d){ blend<M>(s, d); });
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void rotate_blend_any(VIEW_S const& src, VIEW_D const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot, BlendMode mode)
+    {
+        auto const cos = num::cos(rot);
+        auto const sin = num::sin(rot);
+
+        blend_mode_dispatch(mode, [&](auto m)
+        {
+            rotate_blend_any<decltype(m)::value>(src, dst, src_pivot, dst_pivot, cos, sin);
+        });
+    }
+
+
+    template <class VIEW_S, class VIEW_D, class FUNC>
+    static void rotate_blend_transform_any(
+        VIEW_S const& src, VIEW_D const& dst, 
+        Point2Di32 src_pivot, Point2Di32 dst_pivot, 
+        f32 cos, f32 sin, 
+        FUNC const& func)
+    {
+        rotate_any(src, dst, src_pivot, dst_pivot, cos, sin, [&](auto s, Pixel* d){ alpha_blend(func(s), d); });
+    }
+}
+
+
+/* rotate 90 */
+
+namespace image
+{
+    void rotate_90(ImageView const& src, ImageView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.height);
+        assert(src.height == dst.width);
+
+        rotate_bands_90(src, dst);
+    }
+
+
+    void rotate_90(ImageView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.height);
+        assert(src.height == dst.width);
+
+        rotate_bands_90(src, dst);
+    }
+
+
+    void rotate_90(SubView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.height);
+        assert(src.height == dst.width);
+
+        rotate_bands_90(src, dst);
+    }
+
+
+    void rotate_180(ImageView const& src, ImageView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        rotate_bands_180(src, dst);
+    }
+
+
+    void rotate_180(ImageView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        rotate_bands_180(src, dst);
+    }
+
+
+    void rotate_180(SubView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        rotate_bands_180(src, dst);
+    }
+
+
+    void rotate_270(ImageView const& src, ImageView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.height);
+        assert(src.height == dst.width);
+
+        rotate_bands_270(src, dst);
+    }
+
+
+    void rotate_270(ImageView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.height);
+        assert(src.height == dst.width);
+
+        rotate_bands_270(src, dst);
+    }
+
+
+    void rotate_270(SubView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.height);
+        assert(src.height == dst.width);
+
+        rotate_bands_270(src, dst);
+    }
+    
+}
+
+
+/* rotate */
+
+namespace image
+{
+    void rotate(GrayView const& src, GrayView const& dst, Point2Du32 src_pivot, Point2Du32 dst_pivot, uangle rot)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        Point2Di32 sp = { (i32)src_pivot.x, (i32)src_pivot.y };
+        Point2Di32 dp = { (i32)dst_pivot.x, (i32)dst_pivot.y };
+
+        rotate_view_any(src, dst, sp, dp, rot);
+    }
+
+
+    void rotate(ImageView const& src, ImageView const& dst, Point2Du32 src_pivot, Point2Du32 dst_pivot, uangle rot)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        Point2Di32 sp = { (i32)src_pivot.x, (i32)src_pivot.y };
+        Point2Di32 dp = { (i32)dst_pivot.x, (i32)dst_pivot.y };
+
+        rotate_view_any(src, dst, sp, dp, rot);
+    }
+
+
+    void rotate_blend(ImageView const& src, ImageView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        rotate_blend_any(src, dst, src_pivot, dst_pivot, rot, BlendMode::Alpha);
+    }
+
+
+    void rotate_blend(ImageView const& src, SubView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        rotate_blend_any(src, dst, src_pivot, dst_pivot, rot, BlendMode::Alpha);
+    }
+
+
+    void rotate_blend(ImageViewPM const& src, ImageView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        rotate_blend_any(src, dst, src_pivot, dst_pivot, rot, BlendMode::Alpha);
+    }
+
+
+    void rotate_blend(ImageViewPM const& src, SubView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        rotate_blend_any(src, dst, src_pivot, dst_pivot, rot, BlendMode::Alpha);
+    }
+
+
+    void rotate_blend(ImageView const& src, ImageView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot, BlendMode mode)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        rotate_blend_any(src, dst, src_pivot, dst_pivot, rot, mode);
+    }
+
+
+    void rotate_blend(ImageView const& src, SubView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot, BlendMode mode)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        rotate_blend_any(src, dst, src_pivot, dst_pivot, rot, mode);
+    }
+
+
+    void rotate_blend(ImageViewPM const& src, ImageView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot, BlendMode mode)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        rotate_blend_any(src, dst, src_pivot, dst_pivot, rot, mode);
+    }
+
+
+    void rotate_blend(ImageViewPM const& src, SubView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot, BlendMode mode)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        rotate_blend_any(src, dst, src_pivot, dst_pivot, rot, mode);
+    }
+
+
+    void rotate_blend_transform(GraySubView const& src, SubView const& dst, Vec2Df32 cos_sin, fn<Pixel(u8)> const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+
+        Point2Di32 sp = { (i32)src.width / 2, (i32)src.height / 2 };
+        Point2Di32 dp = { (i32)dst.width / 2, (i32)dst.height / 2 };
+
+        rotate_blend_transform_any(src, dst, sp, dp, cos_sin.x, cos_sin.y, func);
+    }
+}
+
+
+/* flip */
+
+namespace image
+{
+    template <class VIEW_S, class VIEW_D>
+    static void flip_view_h(VIEW_S const& src, VIEW_D const& dst)
+    {
+        auto const w = src.width;
+        auto const h = src.height;
+
+        for (u32 y = 0; y < h; y++)
+        {
+            reverse_row(row_begin(src, y), row_begin(dst, y), w);
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void flip_view_h_blend(VIEW_S const& src, VIEW_D const& dst)
+    {
+        auto const h = src.height;
+
+        for (u32 y = 0; y < h; y++)
+        {
+            alpha_blend_span_rev(row_span(src, y), row_span(dst, y));
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void flip_view_v(VIEW_S const& src, VIEW_D const& dst)
+    {
+        auto const h = src.height;
+
+        for (u32 y = 0; y < h; y++)
+        {
+            sp::copy(row_span(src, y), row_span(dst, h - y - 1));
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void flip_bands_h(VIEW_S const& src, VIEW_D const& dst)
+    {
+        exe::for_each_row_band(src, dst, [](auto const& s, auto const& d) { flip_view_h(s, d); });
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void flip_bands_h_blend(VIEW_S const& src, VIEW_D const& dst)
+    {
+        exe::for_each_row_band(src, dst, [](auto const& s, auto const& d) { flip_view_h_blend(s, d); });
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void flip_bands_v(VIEW_S const& src, VIEW_D const& dst)
+    {
+        auto const h = dst.height;
+
+        exe::for_each_band(h, [&](u32 y_begin, u32 y_end)
+        {
+            flip_view_v(row_band(src, h - y_end, h - y_begin), row_band(dst, y_begin, y_end));
+        });
+    }
+
+
+    void flip_h(ImageView const& src, ImageView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
+
+        flip_bands_h(src, dst);
+    }
+
+
+    void flip_h(ImageView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
+
+        flip_bands_h(src, dst);
+    }
+
+
+    void flip_h(SubView const& src, ImageView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
+
+        flip_bands_h(src, dst);
+    }
+
+
+    void flip_h(SubView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
+
+        flip_bands_h(src, dst);
+    }
+
+
+    void flip_v(ImageView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
+
+        flip_bands_v(src, dst);
+    }
+
+
+    void flip_h_blend(ImageView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
+
+        flip_bands_h_blend(src, dst);
+    }
+}
+
+
+/* stats */
+
+namespace image
+{
+namespace stats
+{
+    static void histogram_row(Pixel* row, u32 width, Histogram& hist)
+    {
+        for (u32 x = 0; x < width; x++)
+        {
+            auto p = row[x];
+            ++hist.red[p.red];
+            ++hist.green[p.green];
+            ++hist.blue[p.blue];
+            ++hist.alpha[p.alpha];
+        }
+    }
+
+
+    static void histogram_row(u8* row, u32 width, u32 (&counts)[4][256])
+    {
+        // separate tables so repeated values do not serialize on one counter
+        u32 x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            ++counts[0][row[x]];
+            ++counts[1][row[x + 1]];
+            ++counts[2][row[x + 2]];
+            ++counts[3][row[x + 3]];
+        }
+
+        for (; x < width; x++)
+        {
+            ++counts[0][row[x]];
+        }
+    }
+
+
+    template <class VIEW>
+    static void histogram_bands(VIEW const& view, Histogram& hist)
+    {
+        hist = {};
+
+        std::mutex mutex;
+
+        exe::for_each_band(view.height, [&](u32 y_begin, u32 y_end)
+        {
+            Histogram band{};
+
+            for (u32 y = y_begin; y < y_end; y++)
+            {
+                histogram_row(row_begin(view, y), view.width, band);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            for (u32 i = 0; i < 256; i++)
+            {
+                hist.red[i] += band.red[i];
+                hist.green[i] += band.green[i];
+                hist.blue[i] += band.blue[i];
+                hist.alpha[i] += band.alpha[i];
+            }
+        });
+    }
+
+
+    template <class VIEW>
+    static void histogram_bands(VIEW const& view, GrayHistogram& hist)
+    {
+        hist = {};
+
+        std::mutex mutex;
+
+        exe::for_each_band(view.height, [&](u32 y_begin, u32 y_end)
+        {
+            u32 counts[4][256] = {};
+
+            for (u32 y = y_begin; y < y_end; y++)
+            {
+                histogram_row(row_begin(view, y), view.width, counts);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            for (u32 i = 0; i < 256; i++)
+            {
+                hist.counts[i] += counts[0][i] + counts[1][i] + counts[2][i] + counts[3][i];
+            }
+        });
+    }
+}
+}
+
+
+namespace image
+{
+namespace stats
+{
+    class ColorSums
+    {
+    public:
+        Pixel min = to_pixel(255, 255, 255, 255);
+        Pixel max = to_pixel(0, 0, 0, 0);
+
+        u64 red = 0;
+        u64 green = 0;
+        u64 blue = 0;
+        u64 alpha = 0;
+    };
+
+
+    class GraySums
+    {
+    public:
+        u8 min = 255;
+        u8 max = 0;
+
+        u64 total = 0;
+    };
+
+
+    static void add_pixel(ColorSums& sums, Pixel p)
+    {
+        sums.min.red = num::min(sums.min.red, p.red);
+        sums.min.green = num::min(sums.min.green, p.green);
+        sums.min.blue = num::min(sums.min.blue, p.blue);
+        sums.min.alpha = num::min(sums.min.alpha, p.alpha);
+
+        sums.max.red = num::max(sums.max.red, p.red);
+        sums.max.green = num::max(sums.max.green, p.green);
+        sums.max.blue = num::max(sums.max.blue, p.blue);
+        sums.max.alpha = num::max(sums.max.alpha, p.alpha);
+
+        sums.red += p.red;
+        sums.green += p.green;
+        sums.blue += p.blue;
+        sums.alpha += p.alpha;
+    }
+
+
+    static void add_sums(ColorSums& sums, ColorSums const& other)
+    {
+        sums.min.red = num::min(sums.min.red, other.min.red);
+        sums.min.green = num::min(sums.min.green, other.min.green);
+        sums.min.blue = num::min(sums.min.blue, other.min.blue);
+        sums.min.alpha = num::min(sums.min.alpha, other.min.alpha);
+
+        sums.max.red = num::max(sums.max.red, other.max.red);
+        sums.max.green = num::max(sums.max.green, other.max.green);
+        sums.max.blue = num::max(sums.max.blue, other.max.blue);
+        sums.max.alpha = num::max(sums.max.alpha, other.max.alpha);
+
+        sums.red += other.red;
+        sums.green += other.green;
+        sums.blue += other.blue;
+        sums.alpha += other.alpha;
+    }
+
+
+    static void add_sums(GraySums& sums, GraySums const& other)
+    {
+        sums.min = num::min(sums.min, other.min);
+        sums.max = num::max(sums.max, other.max);
+        sums.total += other.total;
+    }
+
+
+#ifdef IMAGE_SIMD_256
+
+    static inline u64 sum_lanes_32(__m256i v)
+    {
+        alignas(32) u32 lanes[8];
+        _mm256_store_si256((__m256i*)lanes, v);
+
+        u64 total = 0;
+        for (u32 i = 0; i < 8; i++)
+        {
+            total += lanes[i];
+        }
+
+        return total;
+    }
+
+#endif
+
+
+    static void min_max_sum_row(Pixel* row, u32 width, ColorSums& sums)
+    {
+        u32 x = 0;
+
+    #ifdef IMAGE_SIMD_256
+
+        constexpr u32 N = N_SIMD_PIXELS;
+
+        if (width >= N)
+        {
+            auto const ch = _mm256_set1_epi32(0xFF);
+
+            auto v_min = _mm256_set1_epi8((char)0xFF);
+            auto v_max = _mm256_setzero_si256();
+
+            // 32 bit lanes, one row of 8 bit values cannot overflow
+            auto red = _mm256_setzero_si256();
+            auto green = _mm256_setzero_si256();
+            auto blue = _mm256_setzero_si256();
+            auto alpha = _mm256_setzero_si256();
+
+            for (; x + N <= width; x += N)
+            {
+                auto v = load_8(row + x);
+
+                v_min = _mm256_min_epu8(v_min, v);
+                v_max = _mm256_max_epu8(v_max, v);
+
+                red = _mm256_add_epi32(red, _mm256_and_si256(v, ch));
+                green = _mm256_add_epi32(green, _mm256_and_si256(_mm256_srli_epi32(v, 8), ch));
+                blue = _mm256_add_epi32(blue, _mm256_and_si256(_mm256_srli_epi32(v, 16), ch));
+                alpha = _mm256_add_epi32(alpha, _mm256_srli_epi32(v, 24));
+            }
+
+            Pixel mins[N];
+            Pixel maxs[N];
+            store_8(v_min, mins);
+            store_8(v_max, maxs);
+
+            ColorSums lanes{};
+            for (u32 i = 0; i < N; i++)
+            {
+                add_pixel(lanes, mins[i]);
+                add_pixel(lanes, maxs[i]);
+            }
+
+            lanes.red = sum_lanes_32(red);
+            lanes.green = sum_lanes_32(green);
+            lanes.blue = sum_lanes_32(blue);
+            lanes.alpha = sum_lanes_32(alpha);
+
+            add_sums(sums, lanes);
+        }
+
+    #endif
+
+        for (; x < width; x++)
+        {
+            add_pixel(sums, row[x]);
+        }
+    }
+
+
+    static void min_max_sum_row(u8* row, u32 width, GraySums& sums)
+    {
+        u32 x = 0;
+
+    #ifdef IMAGE_SIMD_256
+
+        constexpr u32 N = 32;
+
+        if (width >= N)
+        {
+            auto const zero = _mm256_setzero_si256();
+
+            auto v_min = _mm256_set1_epi8((char)0xFF);
+            auto v_max = zero;
+            auto total = zero;
+
+            for (; x + N <= width; x += N)
+            {
+                auto v = _mm256_loadu_si256((__m256i*)(row + x));
+
+                v_min = _mm256_min_epu8(v_min, v);
+                v_max = _mm256_max_epu8(v_max, v);
+
+                // 4 x 64 bit sums of 8 bytes each
+                total = _mm256_add_epi64(total, _mm256_sad_epu8(v, zero));
+            }
+
+            alignas(32) u8 mins[N];
+            alignas(32) u8 maxs[N];
+            alignas(32) u64 totals[4];
+            _mm256_store_si256((__m256i*)mins, v_min);
+            _mm256_store_si256((__m256i*)maxs, v_max);
+            _mm256_store_si256((__m256i*)totals, total);
+
+            for (u32 i = 0; i < N; i++)
+            {
+                sums.min = num::min(sums.min, mins[i]);
+                sums.max = num::max(sums.max, maxs[i]);
+            }
+
+            sums.total += totals[0] + totals[1] + totals[2] + totals[3];
+        }
+
+    #endif
+
+        for (; x < width; x++)
+        {
+            auto v = row[x];
+            sums.min = num::min(sums.min, v);
+            sums.max = num::max(sums.max, v);
+            sums.total += v;
+        }
+    }
+
+
+    template <class VIEW, class SUMS>
+    static SUMS min_max_sum_bands(VIEW const& view)
+    {
+        SUMS sums{};
+
+        std::mutex mutex;
+
+        exe::for_each_band(view.height, [&](u32 y_begin, u32 y_end)
+        {
+            SUMS band{};
+
+            for (u32 y = y_begin; y < y_end; y++)
+            {
+                min_max_sum_row(row_begin(view, y), view.width, band);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            add_sums(sums, band);
+        });
+
+        return sums;
+    }
+
+
+    static inline u8 mean_u8(u64 total, u64 count)
+    {
+        return (u8)((total + count / 2) / count);
+    }
+
+
+    template <class VIEW>
+    static ColorStats color_stats(VIEW const& view)
+    {
+        auto sums = min_max_sum_bands<VIEW, ColorSums>(view);
+        u64 const count = (u64)view.width * view.height;
+
+        ColorStats stats{};
+        stats.min = sums.min;
+        stats.max = sums.max;
+        stats.mean = to_pixel(
+            mean_u8(sums.red, count), 
+            mean_u8(sums.green, count), 
+            mean_u8(sums.blue, count), 
+            mean_u8(sums.alpha, count));
+
+        return stats;
+    }
+
+
+    template <class VIEW>
+    static GrayStats gray_stats(VIEW const& view)
+    {
+        auto sums = min_max_sum_bands<VIEW, GraySums>(view);
+        u64 const count = (u64)view.width * view.height;
+
+        GrayStats stats{};
+        stats.min = sums.min;
+        stats.max = sums.max;
+        stats.mean = mean_u8(sums.total, count);
+
+        return stats;
+    }
+}
+}
+
+
+namespace image
+{
+namespace stats
+{
+    class RowCoverage
+    {
+    public:
+        u64 count = 0;
+        u64 x_sum = 0;
+
+        u32 x_first = 0;
+        u32 x_last = 0;
+    };
+
+
+    class Coverage
+    {
+    public:
+        u64 count = 0;
+        u64 x_sum = 0;
+        u64 y_sum = 0;
+
+        u32 x_min = 0xFFFFFFFF;
+        u32 x_max = 0;
+        u32 y_min = 0xFFFFFFFF;
+        u32 y_max = 0;
+    };
+
+
+    // bit i of mask is set when x + i is covered
+    static inline void add_mask(RowCoverage& row, u32 mask, u32 x)
+    {
+        if (!mask)
+        {
+            return;
+        }
+
+        u64 const n = std::popcount(mask);
+
+        // sum of set bit positions, one popcount per bit of the position
+        u64 const i_sum =
+            std::popcount(mask & 0xAAAAAAAAu) +
+            2 * std::popcount(mask & 0xCCCCCCCCu) +
+            4 * std::popcount(mask & 0xF0F0F0F0u) +
+            8 * std::popcount(mask & 0xFF00FF00u) +
+            16 * std::popcount(mask & 0xFFFF0000u);
+
+        if (!row.count)
+        {
+            row.x_first = x + std::countr_zero(mask);
+        }
+
+        row.x_last = x + 31 - std::countl_zero(mask);
+        row.count += n;
+        row.x_sum += n * x + i_sum;
+    }
+
+
+    static RowCoverage row_coverage(Pixel* row, u32 width)
+    {
+        RowCoverage cov{};
+
+        u32 x = 0;
+
+    #ifdef IMAGE_SIMD_256
+
+        constexpr u32 N = N_SIMD_PIXELS;
+
+        auto const zero = _mm256_setzero_si256();
+
+        for (; x + N <= width; x += N)
+        {
+            auto alpha = _mm256_srli_epi32(load_8(row + x), 24);
+            auto empty = (u32)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(alpha, zero)));
+
+            add_mask(cov, ~empty & 0xFF, x);
+        }
+
+    #endif
+
+        for (; x < width; x += 32)
+        {
+            auto len = num::min(32u, width - x);
+
+            u32 mask = 0;
+            for (u32 i = 0; i < len; i++)
+            {
+                mask |= (u32)(row[x + i].alpha > 0) << i;
+            }
+
+            add_mask(cov, mask, x);
+        }
+
+        return cov;
+    }
+
+
+    static RowCoverage row_coverage(u8* row, u32 width)
+    {
+        RowCoverage cov{};
+
+        u32 x = 0;
+
+    #ifdef IMAGE_SIMD_256
+
+        constexpr u32 N = 32;
+
+        auto const zero = _mm256_setzero_si256();
+
+        for (; x + N <= width; x += N)
+        {
+            auto v = _mm256_loadu_si256((__m256i*)(row + x));
+            auto empty = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+
+            add_mask(cov, ~empty, x);
+        }
+
+    #endif
+
+        for (; x < width; x += 32)
+        {
+            auto len = num::min(32u, width - x);
+
+            u32 mask = 0;
+            for (u32 i = 0; i < len; i++)
+            {
+                mask |= (u32)(row[x + i] > 0) << i;
+            }
+
+            add_mask(cov, mask, x);
+        }
+
+        return cov;
+    }
+
+
+    template <class VIEW>
+    static Coverage coverage_bands(VIEW const& view)
+    {
+        Coverage total{};
+
+        std::mutex mutex;
+
+        exe::for_each_band(view.height, [&](u32 y_begin, u32 y_end)
+        {
+            Coverage band{};
+
+            for (u32 y = y_begin; y < y_end; y++)
+            {
+                auto row = row_coverage(row_begin(view, y), view.width);
+                if (!row.count)
+                {
+                    continue;
+                }
+
+                band.count += row.count;
+                band.x_sum += row.x_sum;
+                band.y_sum += row.count * y;
+                band.x_min = num::min(band.x_min, row.x_first);
+                band.x_max = num::max(band.x_max, row.x_last);
+                band.y_min = num::min(band.y_min, y);
+                band.y_max = y;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            total.count += band.count;
+            total.x_sum += band.x_sum;
+            total.y_sum += band.y_sum;
+            total.x_min = num::min(total.x_min, band.x_min);
+            total.x_max = num::max(total.x_max, band.x_max);
+            total.y_min = num::min(total.y_min, band.y_min);
+            total.y_max = num::max(total.y_max, band.y_max);
+        });
+
+        return total;
+    }
+
+
+    template <class VIEW>
+    static Rect2Du32 coverage_bounds_bands(VIEW const& view)
+    {
+        auto cov = coverage_bands(view);
+
+        Rect2Du32 rect{};
+
+        if (cov.count)
+        {
+            rect.x_begin = cov.x_min;
+            rect.x_end = cov.x_max + 1;
+            rect.y_begin = cov.y_min;
+            rect.y_end = cov.y_max + 1;
+        }
+
+        return rect;
+    }
+
+
+    template <class VIEW>
+    static Point2Du32 centroid_bands(VIEW const& view)
+    {
+        auto cov = coverage_bands(view);
+
+        Point2Du32 pt{};
+
+        if (cov.count)
+        {
+            pt.x = (u32)(cov.x_sum / cov.count);
+            pt.y = (u32)(cov.y_sum / cov.count);
+        }
+        else
+        {
+            pt.x = view.width / 2;
+            pt.y = view.height / 2;
+        }
+
+        return pt;
+    }
+}
+}
+
+
+namespace image
+{
+namespace stats
+{
+    void histogram(ImageView const& view, Histogram& hist)
+    {
+        assert(view.matrix_data_);
+
+        histogram_bands(view, hist);
+    }
+
+
+    void histogram(SubView const& view, Histogram& hist)
+    {
+        assert(view.matrix_data_);
+
+        histogram_bands(view, hist);
+    }
+
+
+    void histogram(GrayView const& view, GrayHistogram& hist)
+    {
+        assert(view.matrix_data_);
+
+        histogram_bands(view, hist);
+    }
+
+
+    void histogram(GraySubView const& view, GrayHistogram& hist)
+    {
+        assert(view.matrix_data_);
+
+        histogram_bands(view, hist);
+    }
+
+
+    ColorStats min_max_mean(ImageView const& view)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        return color_stats(view);
+    }
+
+
+    ColorStats min_max_mean(SubView const& view)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        return color_stats(view);
+    }
+
+
+    GrayStats min_max_mean(GrayView const& view)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        return gray_stats(view);
+    }
+
+
+    GrayStats min_max_mean(GraySubView const& view)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        return gray_stats(view);
+    }
+
+
+    u64 count_coverage(ImageView const& view)
+    {
+        assert(view.matrix_data_);
+
+        return coverage_bands(view).count;
+    }
+
+
+    u64 count_coverage(SubView const& view)
+    {
+        assert(view.matrix_data_);
+
+        return coverage_bands(view).count;
+    }
+
+
+    u64 count_coverage(GrayView const& view)
+    {
+        assert(view.matrix_data_);
+
+        return coverage_bands(view).count;
+    }
+
+
+    u64 count_coverage(GraySubView const& view)
+    {
+        assert(view.matrix_data_);
+
+        return coverage_bands(view).count;
+    }
+
+
+    Rect2Du32 coverage_bounds(ImageView const& view)
+    {
+        assert(view.matrix_data_);
+
+        return coverage_bounds_bands(view);
+    }
+
+
+    Rect2Du32 coverage_bounds(SubView const& view)
+    {
+        assert(view.matrix_data_);
+
+        return coverage_bounds_bands(view);
+    }
+
+
+    Rect2Du32 coverage_bounds(GrayView const& view)
+    {
+        assert(view.matrix_data_);
+
+        return coverage_bounds_bands(view);
+    }
+
+
+    Rect2Du32 coverage_bounds(GraySubView const& view)
+    {
+        assert(view.matrix_data_);
+
+        return coverage_bounds_bands(view);
+    }
+
+
+    Point2Du32 centroid(ImageView const& view)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        return centroid_bands(view);
+    }
+
+
+    Point2Du32 centroid(SubView const& view)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        return centroid_bands(view);
+    }
+
+
+    Point2Du32 centroid(GrayView const& view)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        return centroid_bands(view);
+    }
+
+
+    Point2Du32 centroid(GraySubView const& view)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        return centroid_bands(view);
+    }
+}
+}
+
+
+/* resize */
+
+namespace image
+{
+    static inline u8 box_average(u32 sum, u32 n_pixels, u32 shift)
+    {
+        // n_pixels = scale * scale, shift = log2(n_pixels) if it is a power of 2
+        auto half = n_pixels / 2;
+
+        return (u8)(shift ? (sum + half) >> shift : (sum + half) / n_pixels);
+    }
+
+
+    static void scale_down_row_sums(u16* sums, u32 n_values, u32 scale, Pixel* d, u32 n_pixels, u32 shift)
+    {
+        // sums: vertical channel sums for n_values / 4 source pixels
+        u32 const step = 4 * scale;
+
+        for (u32 i = 0; i < n_values; i += step, ++d)
+        {
+            u32 red = 0;
+            u32 green = 0;
+            u32 blue = 0;
+            u32 alpha = 0;
+
+            auto s = sums + i;
+            for (u32 u = 0; u < step; u += 4)
+            {
+                red   += s[u];
+                green += s[u + 1];
+                blue  += s[u + 2];
+                alpha += s[u + 3];
+            }
+
+            d->red   = box_average(red, n_pixels, shift);
+            d->green = box_average(green, n_pixels, shift);
+            d->blue  = box_average(blue, n_pixels, shift);
+            d->alpha = box_average(alpha, n_pixels, shift);
+        }
+    }
+
+
+    static void scale_down_add_row(Pixel* src, u16* sums, u32 n_values)
+    {
+        auto s = (u8*)src;
+
+        u32 i = 0;
+
+    #ifdef IMAGE_SIMD_256
+
+        constexpr u32 N = 16;
+
+        for (; i + N <= n_values; i += N)
+        {
+            auto s16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)(s + i)));
+            auto acc = _mm256_loadu_si256((__m256i*)(sums + i));
+            _mm256_storeu_si256((__m256i*)(sums + i), _mm256_add_epi16(acc, s16));
+        }
+
+    #endif
+
+        for (; i < n_values; i++)
+        {
+            sums[i] += s[i];
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void scale_down_view_n(VIEW_S const& src, VIEW_D const& dst, u32 scale)
+    {
+        // u16 vertical sums, 255 * scale must fit
+        assert(scale <= 257);
+
+        constexpr u32 MAX_SRC_PIXELS = 512;
+
+        u16 sums[4 * MAX_SRC_PIXELS];
+
+        u32 const n_pixels = scale * scale;
+
+        u32 shift = 0;
+        if (num::is_power_of_2(n_pixels))
+        {
+            for (; (1u << shift) < n_pixels; shift++) {}
+        }
+
+        u32 const chunk_dst = num::max(MAX_SRC_PIXELS / scale, 1u);
+
+        for (u32 yd = 0; yd < dst.height; yd++)
+        {
+            auto ys = scale * yd;
+            auto rd = row_begin(dst, yd);
+
+            for (u32 xd = 0; xd < dst.width; xd += chunk_dst)
+            {
+                auto n_dst = num::min(chunk_dst, dst.width - xd);
+                auto n_values = 4 * n_dst * scale;
+
+                sp::fill_u8((u8*)sums, 0, n_values * sizeof(u16));
+
+                for (u32 v = 0; v < scale; v++)
+                {
+                    scale_down_add_row(row_begin(src, ys + v) + scale * xd, sums, n_values);
+                }
+
+                scale_down_row_sums(sums, n_values, scale, rd + xd, n_pixels, shift);
+            }
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void scale_down_view_large(VIEW_S const& src, VIEW_D const& dst, u32 scale)
+    {
+        u64 const n_pixels = (u64)scale * scale;
+        u64 const half = n_pixels / 2;
+
+        for (u32 yd = 0; yd < dst.height; yd++)
+        {
+            auto ys = scale * yd;
+            auto rd = row_begin(dst, yd);
+
+            for (u32 xd = 0; xd < dst.width; xd++)
+            {
+                auto xs = scale * xd;
+
+                u64 red = 0;
+                u64 green = 0;
+                u64 blue = 0;
+                u64 alpha = 0;
+
+                for (u32 v = 0; v < scale; v++)
+                {
+                    auto rs = row_begin(src, ys + v) + xs;
+                    for (u32 u = 0; u < scale; u++)
+                    {
+                        auto p = rs[u];
+                        red   += p.red;
+                        green += p.green;
+                        blue  += p.blue;
+                        alpha += p.alpha;
+                    }
+                }
+
+                auto& d = rd[xd];
+                d.red   = (u8)((red + half) / n_pixels);
+                d.green = (u8)((green + half) / n_pixels);
+                d.blue  = (u8)((blue + half) / n_pixels);
+                d.alpha = (u8)((alpha + half) / n_pixels);
+            }
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void scale_down_view_2(VIEW_S const& src, VIEW_D const& dst)
+    {
+        u32 xd = 0;
+
+        for (u32 yd = 0; yd < dst.height; yd++)
+        {
+            auto rs0 = row_begin(src, 2 * yd);
+            auto rs1 = row_begin(src, 2 * yd + 1);
+            auto rd = row_begin(dst, yd);
+
+            xd = 0;
+
+        #ifdef IMAGE_SIMD_256
+
+            // 8 source pixels from each row to 4 destination pixels
+            auto const c2 = _mm256_set1_epi16(2);
+            auto const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+            auto const sum_4 = [](Pixel* r0, Pixel* r1)
+            {
+                // lane 0: p0, p1, lane 1: p2, p3
+                auto a = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)r0));
+                auto b = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)r1));
+                auto v = _mm256_add_epi16(a, b);
+
+                // p0 + p1, p2 + p3
+                return _mm256_add_epi16(v, _mm256_srli_si256(v, 8));
+            };
+
+            for (; 2 * xd + 8 <= src.width; xd += 4)
+            {
+                auto lo = sum_4(rs0 + 2 * xd, rs1 + 2 * xd);
+                auto hi = sum_4(rs0 + 2 * xd + 4, rs1 + 2 * xd + 4);
+
+                // lane 0: d0, d2, lane 1: d1, d3
+                auto sum = _mm256_unpacklo_epi64(lo, hi);
+                sum = _mm256_srli_epi16(_mm256_add_epi16(sum, c2), 2);
+
+                auto res = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(sum, sum), order);
+                _mm_storeu_si128((__m128i*)(rd + xd), _mm256_castsi256_si128(res));
+            }
+
+        #endif
+
+            for (; xd < dst.width; xd++)
+            {
+                auto p00 = rs0[2 * xd];
+                auto p01 = rs0[2 * xd + 1];
+                auto p10 = rs1[2 * xd];
+                auto p11 = rs1[2 * xd + 1];
+
+                auto& d = rd[xd];
+                d.red   = (u8)((p00.red + p01.red + p10.red + p11.red + 2) >> 2);
+                d.green = (u8)((p00.green + p01.green + p10.green + p11.green + 2) >> 2);
+                d.blue  = (u8)((p00.blue + p01.blue + p10.blue + p11.blue + 2) >> 2);
+                d.alpha = (u8)((p00.alpha + p01.alpha + p10.alpha + p11.alpha + 2) >> 2);
+            }
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void scale_down_view(VIEW_S const& src, VIEW_D const& dst, u32 scale)
+    {
+        // box filter, each channel rounded to nearest
+        if (scale == 2)
+        {
+            scale_down_view_2(src, dst);
+        }
+        else if (scale <= 257)
+        {
+            scale_down_view_n(src, dst, scale);
+        }
+        else
+        {
+            scale_down_view_large(src, dst, scale);
+        }
+    }
+
+
+    static void scale_up_row_n(Pixel* s, Pixel* d, u32 width, u32 scale)
+    {
+        for (u32 xs = 0; xs < width; xs++)
+        {
+            auto p = s[xs];
+            for (u32 u = 0; u < scale; u++)
+            {
+                d[u] = p;
+            }
+
+            d += scale;
+        }
+    }
+
+
+#ifdef IMAGE_SIMD_256
+
+    template <u32 SCALE>
+    static void scale_up_row(Pixel* s, Pixel* d, u32 width)
+    {
+        static_assert(SCALE >= 2 && SCALE <= 4);
+
+        constexpr u32 N = N_SIMD_PIXELS;
+
+        // permute indices for each group of 8 destination pixels
+        alignas(32) static constexpr i32 idx2[2 * N] = {
+            0, 0, 1, 1, 2, 2, 3, 3, 
+            4, 4, 5, 5, 6, 6, 7, 7 
+        };
+
+        alignas(32) static constexpr i32 idx3[3 * N] = {
+            0, 0, 0, 1, 1, 1, 2, 2, 
+            2, 3, 3, 3, 4, 4, 4, 5, 
+            5, 5, 6, 6, 6, 7, 7, 7
+        };
+
+        alignas(32) static constexpr i32 idx4[4 * N] = {
+            0, 0, 0, 0, 1, 1, 1, 1, 
+            2, 2, 2, 2, 3, 3, 3, 3,
+            4, 4, 4, 4, 5, 5, 5, 5, 
+            6, 6, 6, 6, 7, 7, 7, 7
+        };
+
+        constexpr i32 const* idx = SCALE == 2 ? idx2 : (SCALE == 3 ? idx3 : idx4);
+
+        __m256i perm[SCALE];
+        for (u32 i = 0; i < SCALE; i++)
+        {
+            perm[i] = _mm256_load_si256((__m256i*)(idx + i * N));
+        }
+
+        u32 xs = 0;
+        for (; xs + N <= width; xs += N)
+        {
+            auto p8 = load_8(s + xs);
+            for (u32 i = 0; i < SCALE; i++)
+            {
+                store_8(_mm256_permutevar8x32_epi32(p8, perm[i]), d + i * N);
+            }
+
+            d += SCALE * N;
+        }
+
+        scale_up_row_n(s + xs, d, width - xs, SCALE);
+    }
+
+#else
+
+    template <u32 SCALE>
+    static void scale_up_row(Pixel* s, Pixel* d, u32 width)
+    {
+        scale_up_row_n(s, d, width, SCALE);
+    }
+
+#endif
+
+
+    static void scale_up_row(Pixel* s, Pixel* d, u32 width, u32 scale)
+    {
+        switch (scale)
+        {
+        case 2:
+            scale_up_row<2>(s, d, width);
+            break;
+
+        case 3:
+            scale_up_row<3>(s, d, width);
+            break;
+
+        case 4:
+            scale_up_row<4>(s, d, width);
+            break;
+
+        default:
+            scale_up_row_n(s, d, width, scale);
+            break;
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void scale_up_view(VIEW_S const& src, VIEW_D const& dst, u32 scale)
+    {
+        // expand each source row once, then copy it to the remaining scale - 1 rows
+
+        u32 yd = 0;
+        for (u32 ys = 0; ys < src.height; ys++)
+        {
+            auto rs = row_begin(src, ys);
+            auto rd = row_span(dst, yd);
+
+            if (scale == 1)
+            {
+                sp::copy(row_span(src, ys), rd);
+            }
+            else
+            {
+                scale_up_row(rs, rd.data, src.width, scale);
+            }
+
+            ++yd;
+            for (u32 v = 1; v < scale; v++, yd++)
+            {
+                sp::copy(rd, row_span(dst, yd));
+            }
+        }
+    }
+
+
+    template <class VIEW_A, class VIEW_B>
+    static bool views_overlap(VIEW_A const& a, VIEW_B const& b)
+    {
+        auto const a_begin = row_begin(a, 0);
+        auto const b_begin = row_begin(b, 0);
+        auto const a_end = row_begin(a, a.height - 1) + a.width;
+        auto const b_end = row_begin(b, b.height - 1) + b.width;
+
+        if (a_end <= b_begin || b_end <= a_begin)
+        {
+            return false;
+        }
+
+        auto const stride = row_stride(a);
+        if (row_stride(b) != stride)
+        {
+            return true;
+        }
+
+        // same stride, b is offset rows and columns from a
+        auto const offset = b_begin - a_begin;
+        auto const dy = offset >= 0 ? offset / stride : -((-offset + stride - 1) / stride);
+        auto const dx = offset - dy * stride;
+
+        if (dx + b.width > stride)
+        {
+            return true; // b wraps past the end of a row
+        }
+
+        return dy < (i64)a.height && dy + b.height > 0 && dx < (i64)a.width;
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void scale_down_bands(VIEW_S const& src, VIEW_D const& dst, u32 scale)
+    {
+        if (views_overlap(src, dst))
+        {
+            // Rows are written in order and each dst pixel after the src pixels it averages.
+            // No src pixel is overwritten before it is read when dst starts at or before src
+            // and dst rows are no farther apart than scale src rows.
+            assert(row_begin(dst, 0) <= row_begin(src, 0));
+            assert(row_stride(dst) <= scale * row_stride(src));
+
+            scale_down_view(src, dst, scale);
+            return;
+        }
+
+        // dst rows [y_begin, y_end) read src rows [scale * y_begin, scale * y_end)
+        exe::for_each_band(dst.height, [&](u32 y_begin, u32 y_end)
+        {
+            scale_down_view(row_band(src, scale * y_begin, scale * y_end), row_band(dst, y_begin, y_end), scale);
+        });
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void scale_up_bands(VIEW_S const& src, VIEW_D const& dst, u32 scale)
+    {
+        // src rows [y_begin, y_end) write dst rows [scale * y_begin, scale * y_end)
+        auto min_rows = (exe::execution.min_rows + scale - 1) / scale;
+
+        exe::for_each_band(src.height, min_rows, [&](u32 y_begin, u32 y_end)
+        {
+            scale_up_view(row_band(src, y_begin, y_end), row_band(dst, scale * y_begin, scale * y_end), scale);
+        });
+    }
+
+
+    void scale_down(ImageView const& src, ImageView const& dst, u32 scale)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == scale * dst.width);
+        assert(src.height == scale * dst.height);
+
+        if (scale == 1)
+        {
+            copy(src, dst);
+            return;
+        }
+        
+        scale_down_bands(src, dst, scale);
+    }
+
+
+    void scale_down(SubView const& src, SubView const& dst, u32 scale)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == scale * dst.width);
+        assert(src.height == scale * dst.height);
+
+        if (scale == 1)
+        {
+            copy(src, dst);
+            return;
+        }
+        
+        scale_down_bands(src, dst, scale);
+    }
+
+
+    void scale_up(ImageView const& src, ImageView const& dst, u32 scale)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width * scale);
+        assert(dst.height == src.height * scale);
+
+        scale_up_bands(src, dst, scale);
+    }
+
+
+    void scale_up(ImageView const& src, SubView const& dst, u32 scale)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width * scale);
+        assert(dst.height == src.height * scale);
+
+        scale_up_bands(src, dst, scale);
+    }
+
+
+    void scale_up(SubView const& src, SubView const& dst, u32 scale)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width * scale);
+        assert(dst.height == src.height * scale);
+
+        scale_up_bands(src, dst, scale);
+    }
+
+
+    bool resize(ImageView const& src, ImageView const& dst)
+    {
+#ifdef IMAGE_RESIZE
+        assert(src.width);
+		assert(src.height);
+		assert(src.matrix_data_);
+		assert(dst.width);
+		assert(dst.height);
+        assert(dst.matrix_data_);
+
+		int channels = 4;
+        auto layout = stbir_pixel_layout::STBIR_RGBA;
+
+		int width_src = (int)(src.width);
+		int height_src = (int)(src.height);
+		int stride_bytes_src = width_src * channels;
+        u8* data_src = (u8*)src.matrix_data_;
+
+		int width_dst = (int)(dst.width);
+		int height_dst = (int)(dst.height);
+		int stride_bytes_dst = width_dst * channels;
+        u8* data_dst = (u8*)dst.matrix_data_;
+
+        auto data = stbir_resize_uint8_linear(
+			data_src, width_src, height_src, stride_bytes_src,
+			data_dst, width_dst, height_dst, stride_bytes_dst,
+			layout);
+
+		assert(data && " *** stbir_resize_uint8_linear() failed *** ");
+
+        if (!data)
+        {
+            return false;
+        }
+
+		return true;
+#else
+
+        assert(false && " *** IMAGE_RESIZE not enabled *** ");
+        return false;
+
+#endif
+    }
+}
+
+
+/* palette */
+
+namespace image
+{
+    static void expand_palette_span(u8* s, Pixel* d, u32 len, Pixel const* colors)
+    {
+        u32 i = 0;
+
+    #ifdef IMAGE_SIMD_256
+
+        constexpr u32 N = 8;
+        auto table = (int const*)colors;
+
+        for (; i + N <= len; i += N)
+        {
+            auto idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*)(s + i)));
+            _mm256_storeu_si256((__m256i*)(d + i), _mm256_i32gather_epi32(table, idx, 4));
+        }
+
+    #endif
+
+        for (; i < len; i++)
+        {
+            d[i] = colors[s[i]];
+        }
+    }
+
+
+    template <class VIEW_S, class VIEW_D>
+    static void scale_up_palette_view(VIEW_S const& src, VIEW_D const& dst, u32 scale, Palette const& palette)
+    {
+        // indices are expanded in chunks small enough to stay in L1
+        constexpr u32 CHUNK = 256;
+        Pixel buffer[CHUNK];
+
+        u32 yd = 0;
+        for (u32 ys = 0; ys < src.height; ys++)
+        {
+            auto rs = row_begin(src, ys);
+            auto rd = row_span(dst, yd);
+
+            if (scale == 1)
+            {
+                expand_palette_span(rs, rd.data, src.width, palette.colors);
+            }
+            else
+            {
+                for (u32 x = 0; x < src.width; x += CHUNK)
+                {
+                    auto len = num::min(CHUNK, src.width - x);
+                    expand_palette_span(rs + x, buffer, len, palette.colors);
+                    scale_up_row(buffer, rd.data + x * scale, len, scale);
+                }
+            }
+
+            ++yd;
+            for (u32 v = 1; v < scale; v++, yd++)
+            {
+                sp::copy(rd, row_span(dst, yd));
+            }
+        }
     }
 
 
-    void transform(SubView const& src, SubView const& dst, fn<Pixel(Pixel, Pixel)> const& func)
+    template <class VIEW_S, class VIEW_D>
+    static void scale_up_palette_bands(VIEW_S const& src, VIEW_D const& dst, u32 scale, Palette const& palette)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        auto min_rows = (exe::execution.min_rows + scale - 1) / scale;
 
-        transform_sub_view(src, dst, func);
+        exe::for_each_band(src.height, min_rows, [&](u32 y_begin, u32 y_end)
+        {
+            scale_up_palette_view(row_band(src, y_begin, y_end), row_band(dst, scale * y_begin, scale * y_end), scale, palette);
+        });
     }
 
 
-    void transform(GrayView const& src, SubView const& dst, fn<Pixel(u8, Pixel)> const& func)
+    void expand(GrayView const& src, ImageView const& dst, Palette const& palette)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
         assert(dst.width == src.width);
         assert(dst.height == src.height);
 
-        transform_sub_view(src, dst, func);
+        scale_up_palette_bands(src, dst, 1, palette);
     }
 
 
-    void transform(GraySubView const& src, SubView const& dst, fn<Pixel(u8, Pixel)> const& func)
+    void scale_up(GrayView const& src, ImageView const& dst, u32 scale, Palette const& palette)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        assert(scale);
+        assert(dst.width == src.width * scale);
+        assert(dst.height == src.height * scale);
 
-        transform_sub_view(src, dst, func);
+        scale_up_palette_bands(src, dst, scale, palette);
     }
 
 
-    void transform(ImageView const& src, GrayView const& dst, fn<u8(Pixel)> const& func)
+    void scale_up(GrayView const& src, SubView const& dst, u32 scale, Palette const& palette)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        assert(scale);
+        assert(dst.width == src.width * scale);
+        assert(dst.height == src.height * scale);
 
-        transform_view(src, dst, func);
+        scale_up_palette_bands(src, dst, scale, palette);
     }
 
 
-    void transform(ImageView const& src, GraySubView const& dst, fn<u8(Pixel)> const& func)
+    void scale_up(GraySubView const& src, SubView const& dst, u32 scale, Palette const& palette)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        assert(scale);
+        assert(dst.width == src.width * scale);
+        assert(dst.height == src.height * scale);
 
-        transform_sub_view(src, dst, func);
-    }    
+        scale_up_palette_bands(src, dst, scale, palette);
+    }
+}
 
 
-    void transform(GrayView const& src, ImageView const& dst, fn<Pixel(u8)> const& func)
+/* pyramid */
+
+namespace image
+{
+    static Pixel box_average(ImageView const& src, Rect2Du32 const& r)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        u32 red = 0;
+        u32 green = 0;
+        u32 blue = 0;
+        u32 alpha = 0;
 
-        transform_view(src, dst, func);
+        for (u32 y = r.y_begin; y < r.y_end; y++)
+        {
+            auto s = row_begin(src, y);
+            for (u32 x = r.x_begin; x < r.x_end; x++)
+            {
+                red += s[x].red;
+                green += s[x].green;
+                blue += s[x].blue;
+                alpha += s[x].alpha;
+            }
+        }
+
+        auto const n = (r.x_end - r.x_begin) * (r.y_end - r.y_begin);
+        auto const h = n / 2;
+
+        return to_pixel((u8)((red + h) / n), (u8)((green + h) / n), (u8)((blue + h) / n), (u8)((alpha + h) / n));
     }
 
 
-    void transform(GrayView const& src, SubView const& dst, fn<Pixel(u8)> const& func)
+    static void scale_down_level(ImageView const& src, ImageView const& dst)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        // dst is half of src rounded down, an odd last src column or row
+        // is averaged into the last dst column or row
+        auto const odd_x = src.width & 1;
+        auto const odd_y = src.height & 1;
 
-        transform_sub_view(src, dst, func);
+        if (!odd_x && !odd_y)
+        {
+            scale_down_bands(src, dst, 2);
+            return;
+        }
+
+        auto const w = dst.width - odd_x;
+        auto const h = dst.height - odd_y;
+
+        if (w && h)
+        {
+            scale_down_bands(sub_view(src, make_rect(2 * w, 2 * h)), sub_view(dst, make_rect(w, h)), 2);
+        }
+
+        if (odd_x)
+        {
+            auto const x = dst.width - 1;
+            for (u32 y = 0; y < dst.height; y++)
+            {
+                auto y_end = y + 1 == dst.height ? src.height : 2 * y + 2;
+                *xy_at(dst, x, y) = box_average(src, { 2 * x, src.width, 2 * y, y_end });
+            }
+        }
+
+        if (odd_y)
+        {
+            auto const y = dst.height - 1;
+            for (u32 x = 0; x < w; x++)
+            {
+                *xy_at(dst, x, y) = box_average(src, { 2 * x, 2 * x + 2, 2 * y, src.height });
+            }
+        }
     }
 
 
-    void transform(GraySubView const& src, ImageView const& dst, fn<Pixel(u8)> const& func)
+    static void build_pyramid_levels(Pyramid& pyramid)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        for (u32 i = 1; i < pyramid.n_levels; i++)
+        {
+            scale_down_level(pyramid.levels[i - 1], pyramid.levels[i]);
+        }
+    }
 
-        transform_sub_view(src, dst, func);
+
+    template <class VIEW_D>
+    static void sample_nearest(ImageView const& src, VIEW_D const& dst)
+    {
+        // 16.16 steps, sampling at destination pixel centers
+        u64 const step_x = ((u64)src.width << 16) / dst.width;
+        u64 const step_y = ((u64)src.height << 16) / dst.height;
+
+        exe::for_each_band(dst.height, [&](u32 y_begin, u32 y_end)
+        {
+            for (u32 y = y_begin; y < y_end; y++)
+            {
+                auto rs = row_begin(src, (u32)((y * step_y + step_y / 2) >> 16));
+                auto rd = row_begin(dst, y);
+
+                u64 xs = step_x / 2;
+                for (u32 x = 0; x < dst.width; x++, xs += step_x)
+                {
+                    rd[x] = rs[xs >> 16];
+                }
+            }
+        });
     }
 
 
-    void transform(GraySubView const& src, SubView const& dst, fn<Pixel(u8)> const& func)
+    template <class VIEW_D>
+    static void sample_pyramid(Pyramid const& pyramid, VIEW_D const& dst)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        auto const& level = pyramid.levels[select_level(pyramid, dst.width, dst.height)];
 
-        transform_sub_view(src, dst, func);
+        auto const scale = level.width / dst.width;
+
+        if (scale && level.width == scale * dst.width && level.height == scale * dst.height)
+        {
+            if (scale == 1)
+            {
+                copy(level, dst);
+            }
+            else
+            {
+                scale_down_bands(level, dst, scale);
+            }
+
+            return;
+        }
+
+        sample_nearest(level, dst);
     }
 
 
-    void transform_scale_up(GraySubView const& src, SubView const& dst, u32 scale, fn<Pixel(u8, Pixel)> const& func)
+    bool create_pyramid(Pyramid& pyramid, ImageView const& src)
     {
         assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width * scale);
-        assert(dst.height == src.height * scale);
+        assert(src.width);
+        assert(src.height);
 
-        for (u32 src_y = 0; src_y < src.height; src_y++)
+        u32 width = src.width;
+        u32 height = src.height;
+        u32 n_pixels = 0;
+
+        pyramid.n_levels = 0;
+
+        for (;;)
         {
-            auto s = row_begin(src, src_y);
+            pyramid.levels[pyramid.n_levels++] = { nullptr, width, height };
+            n_pixels += width * height;
 
-            for (u32 src_x = 0; src_x < src.width; src_x++)
+            if (width < 2 || height < 2 || pyramid.n_levels == pyramid.max_levels)
             {
-                auto const src_value = s[src_x];
+                break;
+            }
 
-                auto dst_y = src_y * scale;
-                for (u32 offset_y = 0; offset_y < scale; offset_y++, dst_y++)
-                {
-                    auto d = row_begin(dst, dst_y);
+            width /= 2;
+            height /= 2;
+        }
 
-                    auto dst_x = src_x * scale;
-                    for (u32 offset_x = 0; offset_x < scale; offset_x++, dst_x++)
-                    {
-                        d[dst_x] = func(src_value, d[dst_x]);
-                    }                    
-                }
-            }
+        if (!mb::create_buffer(pyramid.buffer, n_pixels, "pyramid"))
+        {
+            pyramid.n_levels = 0;
+            return false;
         }
+
+        for (u32 i = 0; i < pyramid.n_levels; i++)
+        {
+            auto& level = pyramid.levels[i];
+            level.matrix_data_ = mb::push_elements(pyramid.buffer, level.width * level.height);
+        }
+
+        update_pyramid(pyramid, src);
+
+        return true;
     }
 
 
-    void transform_scale_up(ImageView const& src, GrayView const& dst, u32 scale, fn<u8(Pixel)> const& func)
+    void destroy_pyramid(Pyramid& pyramid)
+    {
+        mb::destroy_buffer(pyramid.buffer);
+        pyramid.n_levels = 0;
+    }
+
+
+    void update_pyramid(Pyramid& pyramid, ImageView const& src)
     {
+        assert(pyramid.n_levels);
         assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width * scale);
-        assert(dst.height == src.height * scale);
+        assert(src.width == pyramid.levels[0].width);
+        assert(src.height == pyramid.levels[0].height);
 
-        for (u32 src_y = 0; src_y < src.height; src_y++)
-        {
-            auto s = row_begin(src, src_y);
+        copy(src, pyramid.levels[0]);
+        build_pyramid_levels(pyramid);
+    }
 
-            for (u32 src_x = 0; src_x < src.width; src_x++)
-            {
-                auto const value = func(s[src_x]);
 
-                auto dst_y = src_y * scale;
-                for (u32 offset_y = 0; offset_y < scale; offset_y++, dst_y++)
-                {
-                    auto d = row_begin(dst, dst_y);
+    u32 select_level(Pyramid const& pyramid, u32 width, u32 height)
+    {
+        assert(pyramid.n_levels);
 
-                    auto dst_x = src_x * scale;
-                    for (u32 offset_x = 0; offset_x < scale; offset_x++, dst_x++)
-                    {
-                        d[dst_x] = value;
-                    }
-                }
-            }
+        u32 id = 0;
+        while (id + 1 < pyramid.n_levels && pyramid.levels[id + 1].width >= width && pyramid.levels[id + 1].height >= height)
+        {
+            ++id;
         }
+
+        return id;
+    }
+
+
+    void sample(Pyramid const& pyramid, ImageView const& dst)
+    {
+        assert(pyramid.n_levels);
+        assert(dst.matrix_data_);
+        assert(dst.width);
+        assert(dst.height);
+
+        sample_pyramid(pyramid, dst);
+    }
+
+
+    void sample(Pyramid const& pyramid, SubView const& dst)
+    {
+        assert(pyramid.n_levels);
+        assert(dst.matrix_data_);
+        assert(dst.width);
+        assert(dst.height);
+
+        sample_pyramid(pyramid, dst);
     }
 }
 
 
-/* circle unsafe */
+/* blur */
 
 namespace image
 {
-namespace draw
-{
-    template <class VIEW, typename P>
-    static void circle_outline_unsafe(VIEW const& view, Point2Di32 center, u32 radius, P color)
+    // (sum + n / 2) * m >> 24 rounds sum / n exactly for n <= 255 and fits in 32 bits
+    static inline u32 blur_multiplier(u32 n)
     {
-        static_assert(sizeof(P) == sizeof(view.matrix_data_[0]));
+        return ((1u << 24) + n - 1) / n;
+    }
 
-        i32 const cx = center.x;
-        i32 const cy = center.y;
 
-        assert(view.width >= 2 * radius);
-        assert(view.height >= 2 * radius);
-        assert(cx >= radius);
-        assert(cx <= view.width - radius);
-        assert(cy >= radius);
-        assert(cy <= view.height - radius);
+    static inline u8 blur_divide(u32 sum, u32 n, u32 m)
+    {
+        return (u8)(((sum + n / 2) * m) >> 24);
+    }
 
-        i32 ox = radius;
-        i32 oy = 0;
-        i32 dy = -2;
-        i32 dx = 4 * (radius - 1);
-        i32 D = 2 * radius - 1;
-        i32 mask = 0;
 
-        i32 y = 0;
-        i32 x_min = 0;
-        i32 x_max = 0;
+    static void blur_row(Pixel* s, u32 width, u32 radius, Pixel* d, i64 d_stride)
+    {
+        auto const n = 2 * radius + 1;
+        auto const m = blur_multiplier(n);
+        auto const r = (i32)radius;
+        auto const x_max = (i32)width - 1;
+
+        auto const at = [&](i32 x) { return s[num::clamp(x, 0, x_max)]; };
+
+        u32 red = 0;
+        u32 green = 0;
+        u32 blue = 0;
+        u32 alpha = 0;
+
+        for (i32 x = -r; x <= r; x++)
+        {
+            auto p = at(x);
+            red += p.red;
+            green += p.green;
+            blue += p.blue;
+            alpha += p.alpha;
+        }
+
+        for (i32 x = 0; x <= x_max; x++)
+        {
+            auto& p = d[x * d_stride];
+            p.red = blur_divide(red, n, m);
+            p.green = blur_divide(green, n, m);
+            p.blue = blur_divide(blue, n, m);
+            p.alpha = blur_divide(alpha, n, m);
+
+            auto in = at(x + r + 1);
+            auto out = at(x - r);
+            red += in.red - out.red;
+            green += in.green - out.green;
+            blue += in.blue - out.blue;
+            alpha += in.alpha - out.alpha;
+        }
+    }
+
+
+    static void blur_row(u8* s, u32 width, u32 radius, u8* d, i64 d_stride)
+    {
+        auto const n = 2 * radius + 1;
+        auto const m = blur_multiplier(n);
+        auto const r = (i32)radius;
+        auto const x_max = (i32)width - 1;
+
+        auto const at = [&](i32 x) { return (u32)s[num::clamp(x, 0, x_max)]; };
+
+        u32 sum = 0;
+
+        for (i32 x = -r; x <= r; x++)
+        {
+            sum += at(x);
+        }
+
+        for (i32 x = 0; x <= x_max; x++)
+        {
+            d[x * d_stride] = blur_divide(sum, n, m);
+            sum += at(x + r + 1) - at(x - r);
+        }
+    }
+
+
+#ifdef IMAGE_SIMD_256
+
+    // 8 rows at a time, each vector holds one column of the 8 rows
+    // a ring of the last 2 * radius + 1 columns supplies the values leaving the window
+
+    static void blur_rows_8(Pixel* s, i64 s_stride, u32 width, u32 radius, Pixel* d, i64 d_stride)
+    {
+        auto const n = 2 * radius + 1;
+        auto const r = (i32)radius;
+        auto const x_max = (i32)width - 1;
+
+        auto const m = _mm256_set1_epi32((int)blur_multiplier(n));
+        auto const half = _mm256_set1_epi32((int)(n / 2));
+        auto const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+        // columns are requested in increasing order, 8 at a time from a transposed 8x8 block
+        __m256i block[8];
+        i32 block_x = -8;
+
+        auto const column = [&](i32 x)
+        {
+            x = num::clamp(x, 0, x_max);
+
+            if (x >= block_x + 8)
+            {
+                block_x = x & ~7;
+
+                if (block_x + 8 <= (i32)width)
+                {
+                    for (i32 j = 0; j < 8; j++)
+                    {
+                        block[j] = load_8(s + j * s_stride + block_x);
+                    }
+                }
+                else
+                {
+                    Pixel edge[8];
+                    for (i32 j = 0; j < 8; j++)
+                    {
+                        auto row = s + j * s_stride;
+                        for (i32 i = 0; i < 8; i++)
+                        {
+                            edge[i] = row[num::min(block_x + i, x_max)];
+                        }
+
+                        block[j] = load_8(edge);
+                    }
+                }
+
+                transpose_8x8(block);
+            }
 
-        auto row = row_span(view, 0);
+            return block[x - block_x];
+        };
 
-        auto const write = [&]()
+        auto const divide = [&](__m128i sum)
         {
-            row = row_span(view, y);
-            row.data[x_min] = row.data[x_max] = color;
+            auto v = _mm256_add_epi32(_mm256_cvtepu16_epi32(sum), half);
+            return _mm256_srli_epi32(_mm256_mullo_epi32(v, m), 24);
         };
 
-        while (oy <= ox)
-        {         
-            y = cy - oy;
-            x_min = cx - ox;
-            x_max = cx + ox;
-            write();
-
-            y = cy + oy;
-            write();
+        __m256i ring[2 * MAX_BLUR_RADIUS + 1];
 
-            y = cy - ox;
-            x_min = cx - oy;
-            x_max = cx + oy;
-            write();
+        // channel sums as u16, pixels 0-3 and 4-7
+        auto sum_lo = _mm256_setzero_si256();
+        auto sum_hi = _mm256_setzero_si256();
 
-            y = cy + ox;
-            write();
+        for (i32 i = 0; i < (i32)n; i++)
+        {
+            auto c = column(i - r);
+            ring[i] = c;
+            sum_lo = _mm256_add_epi16(sum_lo, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(c)));
+            sum_hi = _mm256_add_epi16(sum_hi, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(c, 1)));
+        }
 
-            D += dy;
-            dy -= 4;
-            ++oy;
+        u32 head = 0;
 
-            mask = (D >> 31);
-            D += dx & mask;
-            dx -= 4 & mask;
-            ox += mask;
+        for (i32 x = 0; x <= x_max; x++)
+        {
+            auto p01 = divide(_mm256_castsi256_si128(sum_lo));
+            auto p23 = divide(_mm256_extracti128_si256(sum_lo, 1));
+            auto p45 = divide(_mm256_castsi256_si128(sum_hi));
+            auto p67 = divide(_mm256_extracti128_si256(sum_hi, 1));
+
+            auto lo = _mm256_packus_epi32(p01, p23);
+            auto hi = _mm256_packus_epi32(p45, p67);
+            store_8(_mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order), d + x * d_stride);
+
+            auto in = column(x + r + 1);
+            auto out = ring[head];
+            ring[head] = in;
+            head = (head + 1 == n) ? 0 : head + 1;
+
+            sum_lo = _mm256_add_epi16(sum_lo, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(in)));
+            sum_lo = _mm256_sub_epi16(sum_lo, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(out)));
+            sum_hi = _mm256_add_epi16(sum_hi, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(in, 1)));
+            sum_hi = _mm256_sub_epi16(sum_hi, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(out, 1)));
         }
     }
 
 
-    template <class VIEW, typename P>
-    static void circle_fill_unsafe(VIEW const& view, Point2Di32 center, u32 radius, P color)
+    static void blur_rows_8(u8* s, i64 s_stride, u32 width, u32 radius, u8* d, i64 d_stride)
     {
-        static_assert(sizeof(P) == sizeof(view.matrix_data_[0]));
-
-        i32 const cx = center.x;
-        i32 const cy = center.y;
+        // width >= 4, 4 bytes are gathered and the wanted byte shifted down
+        // the last 3 columns are read from width - 4 so the gather stays inside the row
+        auto const n = 2 * radius + 1;
+        auto const r = (i32)radius;
+        auto const x_max = (i32)width - 1;
 
-        assert(view.width >= 2 * radius);
-        assert(view.height >= 2 * radius);
-        assert(cx >= radius);
-        assert(cx <= view.width - radius);
-        assert(cy >= radius);
-        assert(cy <= view.height - radius);
+        auto const m = _mm256_set1_epi32((int)blur_multiplier(n));
+        auto const half = _mm256_set1_epi32((int)(n / 2));
+        auto const low = _mm256_set1_epi32(0xFF);
+        auto const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
 
-        i32 ox = radius;
-        i32 oy = 0;
-        i32 dy = -2;
-        i32 dx = 4 * (radius - 1);
-        i32 D = 2 * radius - 1;
-        i32 mask = 0;
+        auto const st = (i32)s_stride;
+        auto const rows = _mm256_setr_epi32(0, st, 2 * st, 3 * st, 4 * st, 5 * st, 6 * st, 7 * st);
 
-        i32 y = 0;
-        i32 x_begin = 0;
-        i32 x_end = 0;
+        auto const column = [&](i32 x)
+        {
+            x = num::clamp(x, 0, x_max);
+            auto base = num::min(x, (i32)width - 4);
+            auto shift = _mm_cvtsi32_si128(8 * (x - base));
 
-        while (oy <= ox)
-        {      
-            y = cy - oy;
-            x_begin = cx - ox;
-            x_end = cx + ox + 1;
-            fill_span(sub_span(view, y, x_begin, x_end), color);
+            auto v = _mm256_i32gather_epi32((int const*)(s + base), rows, 1);
+            return _mm256_and_si256(_mm256_srl_epi32(v, shift), low);
+        };
 
-            y = cy + oy;
-            fill_span(sub_span(view, y, x_begin, x_end), color);
+        __m256i ring[2 * MAX_BLUR_RADIUS + 1];
 
-            y = cy - ox;
-            x_begin = cx - oy;
-            x_end = cx + oy + 1;
-            fill_span(sub_span(view, y, x_begin, x_end), color);
+        auto sum = _mm256_setzero_si256();
 
-            y = cy + ox;
-            fill_span(sub_span(view, y, x_begin, x_end), color);
+        for (i32 i = 0; i < (i32)n; i++)
+        {
+            auto c = column(i - r);
+            ring[i] = c;
+            sum = _mm256_add_epi32(sum, c);
+        }
 
-            D += dy;
-            dy -= 4;
-            ++oy;
+        u32 head = 0;
 
-            mask = (D >> 31);
-            D += dx & mask;
-            dx -= 4 & mask;
-            ox += mask;
+        for (i32 x = 0; x <= x_max; x++)
+        {
+            auto v = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_add_epi32(sum, half), m), 24);
+            v = _mm256_packus_epi32(v, v);
+            v = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(v, v), order);
+            _mm_storel_epi64((__m128i*)(d + x * d_stride), _mm256_castsi256_si128(v));
+
+            auto in = column(x + r + 1);
+            sum = _mm256_sub_epi32(_mm256_add_epi32(sum, in), ring[head]);
+            ring[head] = in;
+            head = (head + 1 == n) ? 0 : head + 1;
         }
     }
-}
-}
 
+#endif
 
-/* circle */
 
-namespace image
-{
-namespace draw
-{
-    template <class VIEW, typename P>
-    static void circle_outline_safe(VIEW const& view, Point2Di32 center, u32 radius, P color)
+    template <class VIEW_S, class VIEW_D>
+    static void blur_pass(VIEW_S const& src, VIEW_D const& dst, u32 radius)
     {
-        static_assert(sizeof(P) == sizeof(view.matrix_data_[0]));
+        // dst is src transposed, src rows become dst columns
+        assert(dst.width == src.height);
+        assert(dst.height == src.width);
 
-        constexpr i32 oD = 0; // offset to correct diameter
+        auto const s_stride = row_stride(src);
+        auto const d_stride = row_stride(dst);
+        auto const d_begin = row_begin(dst, 0);
 
-        i32 const cx = center.x;
-        i32 const cy = center.y;
+        constexpr u32 G = 8;
 
-        i32 const width = view.width;
-        i32 const height = view.height;
+        auto const n_groups = (src.height + G - 1) / G;
+        auto const min_groups = (exe::execution.min_rows + G - 1) / G;
 
-        i32 ox = radius;
-        i32 oy = 0;
-        i32 dy = -2;
-        i32 dx = 4 * (radius - 1);
-        i32 D = 2 * radius - 1;
-        i32 mask = 0;
+        exe::for_each_band(n_groups, min_groups, [&](u32 g_begin, u32 g_end)
+        {
+            for (u32 g = g_begin; g < g_end; g++)
+            {
+                auto y = G * g;
+                auto y_end = num::min(y + G, src.height);
 
-        i32 y = 0;
-        i32 x_min = 0;
-        i32 x_max = 0;       
+            #ifdef IMAGE_SIMD_256
 
-        auto row = row_span(view, 0);
+                if (y_end - y == G && src.width >= 4)
+                {
+                    blur_rows_8(row_begin(src, y), s_stride, src.width, radius, d_begin + y, d_stride);
+                    continue;
+                }
 
-        auto const write_at_x = [&](i32 x)
-        {
-            if (x >= 0 && x < width)
-            {
-                row.data[x] = color;
-            }
-        };
+            #endif
 
-        auto const write = [&]()
-        {
-            if (y >= 0 & y < height)
-            {
-                row = row_span(view, y);
-                write_at_x(x_min);
-                write_at_x(x_max);
+                for (; y < y_end; y++)
+                {
+                    blur_row(row_begin(src, y), src.width, radius, d_begin + y, d_stride);
+                }
             }
-        };
+        });
+    }
 
-        while (oy <= ox)
-        {         
-            y = cy - oy;
-            x_min = cx - ox;
-            x_max = cx + ox + oD;
-            write();
 
-            y = cy + oy + oD;
-            write();
+    template <typename T>
+    static MatrixView2D<T> make_blur_scratch(MemoryBuffer<T>& scratch, u32 width, u32 height)
+    {
+        // transposed
+        mb::reset_buffer(scratch);
 
-            y = cy - ox;
-            x_min = cx - oy;
-            x_max = cx + oy + oD;
-            write();
+        MatrixView2D<T> view{};
+        view.matrix_data_ = mb::push_elements(scratch, width * height);
+        view.width = height;
+        view.height = width;
 
-            y = cy + ox + oD;
-            write();
+        return view;
+    }
 
-            D += dy;
-            dy -= 4;
-            ++oy;
 
-            mask = (D >> 31);
-            D += dx & mask;
-            dx -= 4 & mask;
-            ox += mask;
+    template <class VIEW, typename T>
+    static void blur_box_passes(VIEW const& src, VIEW const& dst, u32 const* radii, u32 n_radii, MemoryBuffer<T>& scratch)
+    {
+        auto tmp = make_blur_scratch(scratch, src.width, src.height);
+        assert(tmp.matrix_data_);
+
+        if (!tmp.matrix_data_)
+        {
+            return;
+        }
+
+        blur_pass(src, tmp, radii[0]);
+        blur_pass(tmp, dst, radii[0]);
+
+        for (u32 i = 1; i < n_radii; i++)
+        {
+            blur_pass(dst, tmp, radii[i]);
+            blur_pass(tmp, dst, radii[i]);
         }
+
+        mb::reset_buffer(scratch);
     }
 
 
-    template <class VIEW, typename P>
-    static void circle_fill_safe(VIEW const& view, Point2Di32 center, u32 radius, P color)
+    template <class VIEW, typename T>
+    static void blur_box_view(VIEW const& src, VIEW const& dst, u32 radius, MemoryBuffer<T>& scratch)
     {
-        static_assert(sizeof(P) == sizeof(view.matrix_data_[0]));
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
+        assert(radius <= MAX_BLUR_RADIUS);
 
-        constexpr i32 oD = 0; // offset to correct diameter
+        radius = num::min(radius, MAX_BLUR_RADIUS);
 
-        i32 const cx = center.x;
-        i32 const cy = center.y;
+        blur_box_passes(src, dst, &radius, 1, scratch);
+    }
 
-        i32 const width = view.width;
-        i32 const height = view.height;
 
-        i32 ox = radius;
-        i32 oy = 0;
-        i32 dy = -2;
-        i32 dx = 4 * (radius - 1);
-        i32 D = 2 * radius - 1;
-        i32 mask = 0;
+    template <class VIEW, typename T>
+    static void blur_gaussian_view(VIEW const& src, VIEW const& dst, f32 sigma, MemoryBuffer<T>& scratch)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
+        assert(sigma >= 0.0f);
 
-        i32 y = 0;
-        i32 x_begin = 0;
-        i32 x_end = 0;
+        // box widths whose three passes have variance sigma^2
+        constexpr u32 N = 3;
 
-        auto const write = [&]()
+        auto const var12 = 12.0f * sigma * sigma;
+
+        auto wl = (i32)num::floor(num::sqrt(var12 / N + 1.0f));
+        if (wl % 2 == 0)
         {
-            if (y >= 0 & y < height && x_end > 0 && x_begin < width)
-            {
-                x_begin = num::clamp(x_begin, 0, width - 1);
-                x_end = num::clamp(x_end, 1, width);
-                sp::fill(sub_span(view, y, x_begin, x_end), color);
-            }
-        };
+            --wl;
+        }
 
-        while (oy <= ox)
-        {           
-            y = cy - oy;
-            x_begin = cx - ox;
-            x_end = cx + ox + 1 + oD;
-            write();
+        auto const wu = wl + 2;
+        auto const n_lower = num::round_to_signed<i32>((var12 - N * wl * wl - 4 * N * wl - 3 * N) / (-4.0f * wl - 4.0f));
 
-            y = cy + oy + oD;
-            write();
+        u32 radii[N];
+        for (i32 i = 0; i < (i32)N; i++)
+        {
+            auto w = i < n_lower ? wl : wu;
+            radii[i] = num::min((u32)num::max((w - 1) / 2, 0), MAX_BLUR_RADIUS);
+        }
 
-            y = cy - ox;
-            x_begin = cx - oy;
-            x_end = cx + oy + 1 + oD;
-            write();
+        blur_box_passes(src, dst, radii, N, scratch);
+    }
 
-            y = cy + ox + oD;
-            write();
 
-            D += dy;
-            dy -= 4;
-            ++oy;
+    void blur_box(ImageView const& src, ImageView const& dst, u32 radius, Buffer32& scratch)
+    {
+        blur_box_view(src, dst, radius, scratch);
+    }
 
-            mask = (D >> 31);
-            D += dx & mask;
-            dx -= 4 & mask;
-            ox += mask;
-        }
+
+    void blur_box(SubView const& src, SubView const& dst, u32 radius, Buffer32& scratch)
+    {
+        blur_box_view(src, dst, radius, scratch);
     }
 
 
-    void circle_outline(ImageView const& view, Point2Di32 center, u32 radius, Pixel color)
+    void blur_box(GrayView const& src, GrayView const& dst, u32 radius, Buffer8& scratch)
     {
-        circle_outline_safe(view, center, radius, color);
+        blur_box_view(src, dst, radius, scratch);
     }
 
 
-    void circle_outline(SubView const& view, Point2Di32 center, u32 radius, Pixel color)
+    void blur_box(GraySubView const& src, GraySubView const& dst, u32 radius, Buffer8& scratch)
     {
-        circle_outline_safe(view, center, radius, color);
+        blur_box_view(src, dst, radius, scratch);
     }
 
 
-    void circle_fill(ImageView const& view, Point2Di32 center, u32 radius, Pixel color)
+    void blur_gaussian(ImageView const& src, ImageView const& dst, f32 sigma, Buffer32& scratch)
     {
-        circle_fill_safe(view, center, radius, color);
+        blur_gaussian_view(src, dst, sigma, scratch);
     }
 
 
-    void circle_fill(SubView const& view, Point2Di32 center, u32 radius, Pixel color)
+    void blur_gaussian(SubView const& src, SubView const& dst, f32 sigma, Buffer32& scratch)
     {
-        circle_fill_safe(view, center, radius, color);
+        blur_gaussian_view(src, dst, sigma, scratch);
+    }
+
+
+    void blur_gaussian(GrayView const& src, GrayView const& dst, f32 sigma, Buffer8& scratch)
+    {
+        blur_gaussian_view(src, dst, sigma, scratch);
+    }
+
+
+    void blur_gaussian(GraySubView const& src, GraySubView const& dst, f32 sigma, Buffer8& scratch)
+    {
+        blur_gaussian_view(src, dst, sigma, scratch);
     }
-}
 }
 
 
-/* rotate static */
+/* color lut */
 
 namespace image
 {
-    template <class VIEW_S, class VIEW_D>
-    static void rotate_view_90(VIEW_S const& src, VIEW_D const& dst)
+    ColorLUT make_lut_identity()
     {
-        auto const dw = dst.width;
-        auto const dh = dst.height;
+        ColorLUT lut{};
 
-        for (u32 dy = 0; dy < dh; dy++)
+        for (u32 i = 0; i < 256; i++)
         {
-            auto const sx = dy;
-
-            auto d = row_begin(dst, dy);            
-            for (u32 dx = 0; dx < dw; dx++)
-            {
-                auto sy = dw - 1 - dx;
-                d[dx] = *xy_at(src, sx, sy);
-            }
+            lut.red[i] = lut.green[i] = lut.blue[i] = lut.alpha[i] = (u8)i;
         }
+
+        return lut;
     }
 
 
-    template <class VIEW_S, class VIEW_D>
-    static void rotate_view_180(VIEW_S const& src, VIEW_D const& dst)
+    template <class FUNC>
+    static ColorLUT make_lut_rgb(FUNC const& func)
     {
-        auto const dw = dst.width;
-        auto const dh = dst.height;
+        auto lut = make_lut_identity();
 
-        for (u32 dy = 0; dy < dh; dy++)
+        for (u32 i = 0; i < 256; i++)
         {
-            auto const sy = dh - 1 - dy;
-
-            auto d = row_begin(dst, dy);
-            auto s = row_begin(src, sy);
-            for (u32 dx = 0; dx < dw; dx++)
-            {
-                auto sx = dw - 1 - dx;
-                d[dx] = s[sx];
-            }
+            lut.red[i] = func(i, 0);
+            lut.green[i] = func(i, 1);
+            lut.blue[i] = func(i, 2);
         }
+
+        return lut;
     }
 
 
-    template <class VIEW_S, class VIEW_D>
-    static void rotate_view_270(VIEW_S const& src, VIEW_D const& dst)
+    static inline u8 to_lut_value(f32 value)
     {
-        auto const dw = dst.width;
-        auto const dh = dst.height;
+        return num::round_to_unsigned<u8>(num::clamp(value, 0.0f, 255.0f));
+    }
 
-        for (u32 dy = 0; dy < dh; dy++)
-        {
-            auto const sx = dh - 1 - dy;
 
-            auto d = row_begin(dst, dy);
-            for (u32 dx = 0; dx < dw; dx++)
-            {
-                auto sy = dx;
-                d[dx] = *xy_at(src, sx, sy);
-            }
-        }
+    ColorLUT make_lut_gamma(f32 gamma)
+    {
+        assert(gamma > 0.0f);
+
+        return make_lut_rgb([&](u32 i, u32)
+        {
+            return to_lut_value(255.0f * std::pow(i / 255.0f, gamma));
+        });
     }
 
 
-    template <class VIEW_S, class VIEW_D>
-    static void rotate_view_any(VIEW_S const& src, VIEW_D const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, f32 cos, f32 sin)
+    ColorLUT make_lut_brightness(i32 offset)
     {
-        u32 const sw = src.width;
-        u32 const sh = src.height;
+        return make_lut_rgb([&](u32 i, u32)
+        {
+            return (u8)num::clamp((i32)i + offset, 0, 255);
+        });
+    }
 
-        i32 const spx = src_pivot.x;
-        i32 const spy = src_pivot.y;
 
-        i32 const dpx = dst_pivot.x;
-        i32 const dpy = dst_pivot.y;
-        
-        f32 dysin = spx - dpy * sin - dpx * cos - cos;
-        f32 dycos = spy - dpy * cos + dpx * sin + sin;
+    ColorLUT make_lut_contrast(f32 contrast)
+    {
+        return make_lut_rgb([&](u32 i, u32)
+        {
+            return to_lut_value(128.0f + contrast * ((f32)i - 128.0f));
+        });
+    }
 
-        u32 sx = 0;
-        u32 sy = 0;
 
-        f32 sxf = 0.0f;
-        f32 syf = 0.0f;
+    ColorLUT make_lut_tint(Pixel color)
+    {
+        u8 const c[3] = { color.red, color.green, color.blue };
 
-        for (u32 y = 0; y < dst.height; y++)
+        return make_lut_rgb([&](u32 i, u32 ch)
         {
-            auto d = row_begin(dst, y);            
-            
-            sxf = dysin;
-            syf = dycos;
+            return (u8)((i * c[ch] + 127) / 255);
+        });
+    }
 
-            for (u32 x = 0; x < dst.width; x++)
-            { 
-                sxf += cos;
-                syf -= sin;
 
-                if (sxf < 0.0f || syf < 0.0f)
-                {
-                    continue;
-                }
+    ColorLUT make_lut_fade(Pixel color, f32 t)
+    {
+        t = num::clamp(t, 0.0f, 1.0f);
 
-                sx = num::round_to_unsigned<u32>(sxf);
-                sy = num::round_to_unsigned<u32>(syf);
+        f32 const c[3] = { (f32)color.red, (f32)color.green, (f32)color.blue };
 
-                if (sx >= sw || sy >= sh)
-                {
-                    continue;
-                }
+        return make_lut_rgb([&](u32 i, u32 ch)
+        {
+            return to_lut_value(i + t * (c[ch] - i));
+        });
+    }
 
-                d[x] = *xy_at(src, sx, sy);
-            }
 
-            dysin += sin;
-            dycos += cos;
+    ColorLUT combine(ColorLUT const& first, ColorLUT const& second)
+    {
+        ColorLUT lut{};
+
+        for (u32 i = 0; i < 256; i++)
+        {
+            lut.red[i] = second.red[first.red[i]];
+            lut.green[i] = second.green[first.green[i]];
+            lut.blue[i] = second.blue[first.blue[i]];
+            lut.alpha[i] = second.alpha[first.alpha[i]];
         }
+
+        return lut;
     }
+}
 
 
-    template <class VIEW_S, class VIEW_D>
-    static void rotate_view_any(VIEW_S const& src, VIEW_D const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot)
+namespace image
+{
+    // each entry holds the output byte already shifted to its channel
+    class PackedLUT
     {
-        auto const cos = num::cos(rot);
-        auto const sin = num::sin(rot);
+    public:
+        u32 red[256];
+        u32 green[256];
+        u32 blue[256];
+        u32 alpha[256];
+    };
 
-        rotate_view_any(src, dst, src_pivot, dst_pivot, cos, sin);
-    }    
-}
 
+    static void pack_lut(ColorLUT const& lut, PackedLUT& packed)
+    {
+        for (u32 i = 0; i < 256; i++)
+        {
+            packed.red[i] = (u32)lut.red[i];
+            packed.green[i] = (u32)lut.green[i] << 8;
+            packed.blue[i] = (u32)lut.blue[i] << 16;
+            packed.alpha[i] = (u32)lut.alpha[i] << 24;
+        }
+    }
 
-/* rotate_blend static */
 
-namespace image
-{
-    template <class VIEW_S, class VIEW_D>
-    static void rotate_blend_any(VIEW_S const& src, VIEW_D const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, f32 cos, f32 sin)
+    static void lut_span(Pixel* s, Pixel* d, u32 len, PackedLUT const& lut)
     {
-        u32 const sw = src.width;
-        u32 const sh = src.height;
+        u32 i = 0;
 
-        i32 const spx = src_pivot.x;
-        i32 const spy = src_pivot.y;
+    #ifdef IMAGE_SIMD_256
 
-        i32 const dpx = dst_pivot.x;
-        i32 const dpy = dst_pivot.y;
-        
-        f32 dysin = spx - dpy * sin - dpx * cos - cos;
-        f32 dycos = spy - dpy * cos + dpx * sin + sin;
-        
-        u32 sx = 0;
-        u32 sy = 0;
+        constexpr u32 N = N_SIMD_PIXELS;
 
-        f32 sxf = 0.0f;
-        f32 syf = 0.0f;
+        auto const low = _mm256_set1_epi32(0xFF);
 
-        for (u32 y = 0; y < dst.height; y++)
+        auto const red = (int const*)lut.red;
+        auto const green = (int const*)lut.green;
+        auto const blue = (int const*)lut.blue;
+        auto const alpha = (int const*)lut.alpha;
+
+        for (; i + N <= len; i += N)
         {
-            auto d = row_begin(dst, y);
-            
-            sxf = dysin;
-            syf = dycos;
-            
-            for (u32 x = 0; x < dst.width; x++)
-            {
-                sxf += cos;
-                syf -= sin;
+            auto p = load_8(s + i);
 
-                if (sxf < 0.0f || syf < 0.0f)
-                {
-                    continue;
-                }
+            auto r = _mm256_i32gather_epi32(red, _mm256_and_si256(p, low), 4);
+            auto g = _mm256_i32gather_epi32(green, _mm256_and_si256(_mm256_srli_epi32(p, 8), low), 4);
+            auto b = _mm256_i32gather_epi32(blue, _mm256_and_si256(_mm256_srli_epi32(p, 16), low), 4);
+            auto a = _mm256_i32gather_epi32(alpha, _mm256_srli_epi32(p, 24), 4);
 
-                sx = num::round_to_unsigned<u32>(sxf);
-                sy = num::round_to_unsigned<u32>(syf);
+            store_8(_mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, a)), d + i);
+        }
 
-                if (sx >= sw || sy >= sh)
-                {
-                    continue;
-                }
+    #endif
 
-                alpha_blend(xy_at(src, sx, sy), d + x);
-            }
+        auto src = (u32*)s;
+        auto dst = (u32*)d;
 
-            dysin += sin;
-            dycos += cos;
+        for (; i < len; i++)
+        {
+            auto p = src[i];
+            dst[i] = lut.red[p & 0xFF] | lut.green[(p >> 8) & 0xFF] | lut.blue[(p >> 16) & 0xFF] | lut.alpha[p >> 24];
         }
     }
 
 
     template <class VIEW_S, class VIEW_D>
-    static void rotate_blend_any(VIEW_S const& src, VIEW_D const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot)
+    static void lut_bands(VIEW_S const& src, VIEW_D const& dst, ColorLUT const& lut)
     {
-        auto const cos = num::cos(rot);
-        auto const sin = num::sin(rot);
+        PackedLUT packed;
+        pack_lut(lut, packed);
 
-        rotate_blend_any(src, dst, src_pivot, dst_pivot, cos, sin);
+        exe::for_each_row_band(src, dst, [&](auto const& s, auto const& d)
+        {
+            for (u32 y = 0; y < s.height; y++)
+            {
+                lut_span(row_begin(s, y), row_begin(d, y), s.width, packed);
+            }
+        });
     }
 
 
-    template <class VIEW_S, class VIEW_D, class FUNC>
-    static void rotate_blend_transform_any(
-        VIEW_S const& src, VIEW_D const& dst, 
-        Point2Di32 src_pivot, Point2Di32 dst_pivot, 
-        f32 cos, f32 sin, 
-        FUNC const& func)
+    void apply_lut(ImageView const& view, ColorLUT const& lut)
     {
-        u32 const sw = src.width;
-        u32 const sh = src.height;
-
-        i32 const spx = src_pivot.x;
-        i32 const spy = src_pivot.y;
-
-        i32 const dpx = dst_pivot.x;
-        i32 const dpy = dst_pivot.y;
-        
-        f32 dysin = spx - dpy * sin - dpx * cos - cos;
-        f32 dycos = spy - dpy * cos + dpx * sin + sin;
-        
-        u32 sx = 0;
-        u32 sy = 0;
-
-        f32 sxf = 0.0f;
-        f32 syf = 0.0f;
+        assert(view.matrix_data_);
 
-        for (u32 y = 0; y < dst.height; y++)
-        {
-            auto d = row_begin(dst, y);
-            
-            sxf = dysin;
-            syf = dycos;
-            
-            for (u32 x = 0; x < dst.width; x++)
-            {
-                sxf += cos;
-                syf -= sin;
+        lut_bands(view, view, lut);
+    }
 
-                if (sxf < 0.0f || syf < 0.0f)
-                {
-                    continue;
-                }
 
-                sx = num::round_to_unsigned<u32>(sxf);
-                sy = num::round_to_unsigned<u32>(syf);
+    void apply_lut(SubView const& view, ColorLUT const& lut)
+    {
+        assert(view.matrix_data_);
 
-                if (sx >= sw || sy >= sh)
-                {
-                    continue;
-                }
+        lut_bands(view, view, lut);
+    }
 
-                auto sp = *xy_at(src, sx, sy);
-                auto fp = func(sp);
 
-                alpha_blend(fp, d + x);
-            }
+    void copy_lut(ImageView const& src, ImageView const& dst, ColorLUT const& lut)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
 
-            dysin += sin;
-            dycos += cos;
-        }
+        lut_bands(src, dst, lut);
     }
-}
-
 
-/* rotate 90 */
 
-namespace image
-{
-    void rotate_90(ImageView const& src, ImageView const& dst)
+    void copy_lut(ImageView const& src, SubView const& dst, ColorLUT const& lut)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
-        assert(src.width == dst.height);
-        assert(src.height == dst.width);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
 
-        rotate_view_90(src, dst);
+        lut_bands(src, dst, lut);
     }
 
 
-    void rotate_90(ImageView const& src, SubView const& dst)
+    void copy_lut(SubView const& src, SubView const& dst, ColorLUT const& lut)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
-        assert(src.width == dst.height);
-        assert(src.height == dst.width);
+        assert(src.width == dst.width);
+        assert(src.height == dst.height);
 
-        rotate_view_90(src, dst);
+        lut_bands(src, dst, lut);
     }
+}
 
 
-    void rotate_90(SubView const& src, SubView const& dst)
+/* nine slice */
+
+namespace image
+{
+namespace draw
+{
+    // one axis of a nine slice
+    // dst [0, d_begin) shows the src start, dst [d_end, length) the src end
+    // dst [d_begin, d_end) repeats src [s_begin, s_end)
+    class SliceAxis
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(src.width == dst.height);
-        assert(src.height == dst.width);
+    public:
+        u32 s_begin = 0;
+        u32 s_end = 0;
+        u32 s_length = 0;
+
+        u32 d_begin = 0;
+        u32 d_end = 0;
+        u32 d_length = 0;
+    };
+
+
+    static SliceAxis make_slice_axis(u32 src_length, u32 inset_begin, u32 inset_end, u32 dst_length)
+    {
+        assert(inset_begin + inset_end < src_length);
 
-        rotate_view_90(src, dst);
+        SliceAxis a{};
+        a.s_begin = inset_begin;
+        a.s_end = src_length - inset_end;
+        a.s_length = src_length;
+        a.d_length = dst_length;
+
+        if (inset_begin + inset_end <= dst_length)
+        {
+            a.d_begin = inset_begin;
+            a.d_end = dst_length - inset_end;
+        }
+        else
+        {
+            // no center, the borders are cropped in proportion
+            a.d_begin = (u32)((u64)dst_length * inset_begin / (inset_begin + inset_end));
+            a.d_end = a.d_begin;
+        }
+
+        return a;
     }
 
 
-    void rotate_180(ImageView const& src, ImageView const& dst)
+    static inline u32 slice_src(SliceAxis const& a, u32 d)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        if (d < a.d_begin)
+        {
+            return d;
+        }
+
+        if (d >= a.d_end)
+        {
+            return a.s_length - (a.d_length - d);
+        }
 
-        rotate_view_180(src, dst);
+        return a.s_begin + (d - a.d_begin) % (a.s_end - a.s_begin);
     }
 
 
-    void rotate_180(ImageView const& src, SubView const& dst)
+    template <bool BLEND, class VIEW_S>
+    static void nine_slice_view(VIEW_S const& src, NineSliceInsets const& insets, SubView const& dst)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
+        auto const ax = make_slice_axis(src.width, insets.left, insets.right, dst.width);
+        auto const ay = make_slice_axis(src.height, insets.top, insets.bottom, dst.height);
+
+        auto const copy_span = [](SpanView<Pixel> const& s, SpanView<Pixel> const& d)
+        {
+            if constexpr (BLEND) { alpha_blend_span(s, d); } else { sp::copy(s, d); }
+        };
+
+        auto const fill_span = [](SpanView<Pixel> const& d, Pixel color)
+        {
+            if constexpr (BLEND) { alpha_blend_fill_span(d, color); } else { sp::fill_32(d, color); }
+        };
+
+        auto const tile = ax.s_end - ax.s_begin;
+        auto const center = ax.d_end - ax.d_begin;
+        auto const right = dst.width - ax.d_end;
+
+        for (u32 y = 0; y < dst.height; y++)
+        {
+            auto const sy = slice_src(ay, y);
+
+            if constexpr (!BLEND)
+            {
+                // opaque center rows repeat every tile height
+                auto const tile_h = ay.s_end - ay.s_begin;
+
+                if (y >= ay.d_begin + tile_h && y < ay.d_end)
+                {
+                    sp::copy(row_span(dst, y - tile_h), row_span(dst, y));
+                    continue;
+                }
+            }
+
+            if (ax.d_begin)
+            {
+                copy_span(sub_span(src, sy, 0, ax.d_begin), sub_span(dst, y, 0, ax.d_begin));
+            }
+
+            if (center && tile == 1)
+            {
+                fill_span(sub_span(dst, y, ax.d_begin, ax.d_end), *xy_at(src, ax.s_begin, sy));
+            }
+            else if (center)
+            {
+                u32 x = ax.d_begin;
+                u32 n = num::min(tile, center);
+
+                copy_span(sub_span(src, sy, ax.s_begin, ax.s_begin + n), sub_span(dst, y, x, x + n));
+                x += n;
+
+                if constexpr (BLEND)
+                {
+                    for (; x < ax.d_end; x += n)
+                    {
+                        n = num::min(tile, ax.d_end - x);
+                        copy_span(sub_span(src, sy, ax.s_begin, ax.s_begin + n), sub_span(dst, y, x, x + n));
+                    }
+                }
+                else
+                {
+                    // copy what is already written, doubling each time
+                    for (; x < ax.d_end; x += n)
+                    {
+                        n = num::min(x - ax.d_begin, ax.d_end - x);
+                        sp::copy(sub_span(dst, y, ax.d_begin, ax.d_begin + n), sub_span(dst, y, x, x + n));
+                    }
+                }
+            }
 
-        rotate_view_180(src, dst);
+            if (right)
+            {
+                copy_span(sub_span(src, sy, src.width - right, src.width), sub_span(dst, y, ax.d_end, dst.width));
+            }
+        }
     }
 
 
-    void rotate_180(SubView const& src, SubView const& dst)
+    void nine_slice(ImageView const& src, NineSliceInsets const& insets, SubView const& dst)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
-        assert(dst.width == src.width);
-        assert(dst.height == src.height);
 
-        rotate_view_180(src, dst);
+        nine_slice_view<false>(src, insets, dst);
     }
 
 
-    void rotate_270(ImageView const& src, ImageView const& dst)
+    void nine_slice(SubView const& src, NineSliceInsets const& insets, SubView const& dst)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
-        assert(src.width == dst.height);
-        assert(src.height == dst.width);
 
-        rotate_view_270(src, dst);
+        nine_slice_view<false>(src, insets, dst);
     }
 
 
-    void rotate_270(ImageView const& src, SubView const& dst)
+    void nine_slice_blend(ImageView const& src, NineSliceInsets const& insets, SubView const& dst)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
-        assert(src.width == dst.height);
-        assert(src.height == dst.width);
 
-        rotate_view_270(src, dst);
+        nine_slice_view<true>(src, insets, dst);
     }
 
 
-    void rotate_270(SubView const& src, SubView const& dst)
+    void nine_slice_blend(SubView const& src, NineSliceInsets const& insets, SubView const& dst)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
-        assert(src.width == dst.height);
-        assert(src.height == dst.width);
 
-        rotate_view_270(src, dst);
+        nine_slice_view<true>(src, insets, dst);
     }
-    
+}
 }
 
 
-/* rotate */
+/* command list */
 
 namespace image
 {
-    void rotate(GrayView const& src, GrayView const& dst, Point2Du32 src_pivot, Point2Du32 dst_pivot, uangle rot)
+namespace draw
+{
+    enum class CommandType : u8
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
+        Fill,
+        FillBlend,
+        Copy,
+        CopyBlend,
+        Transform,
+        TransformGray,
+        CircleFill,
+        CircleOutline
+    };
+
+
+    class Command
+    {
+    public:
+        CommandType type;
 
-        Point2Di32 sp = { (i32)src_pivot.x, (i32)src_pivot.y };
-        Point2Di32 dp = { (i32)dst_pivot.x, (i32)dst_pivot.y };
+        // target coordinates
+        Rect2Du32 dst;
 
-        rotate_view_any(src, dst, sp, dp, rot);
-    }
+        SubView src;
+        GraySubView src_gray;
 
+        Pixel (*func)(Pixel, Pixel);
+        Pixel (*func_gray)(u8, Pixel);
 
-    void rotate(ImageView const& src, ImageView const& dst, Point2Du32 src_pivot, Point2Du32 dst_pivot, uangle rot)
-    {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
+        Pixel color;
 
-        Point2Di32 sp = { (i32)src_pivot.x, (i32)src_pivot.y };
-        Point2Di32 dp = { (i32)dst_pivot.x, (i32)dst_pivot.y };
+        Point2Di32 center;
+        u32 radius;
+    };
 
-        rotate_view_any(src, dst, sp, dp, rot);
+
+    static Rect2Du32 view_rect(SubView const& view)
+    {
+        return make_rect(view.x_begin, view.y_begin, view.width, view.height);
     }
 
 
-    void rotate_blend(ImageView const& src, ImageView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot)
+    static Rect2Du32 clip_rect(Rect2Du32 const& a, Rect2Du32 const& b)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
+        Rect2Du32 r{};
+        r.x_begin = num::max(a.x_begin, b.x_begin);
+        r.x_end = num::min(a.x_end, b.x_end);
+        r.y_begin = num::max(a.y_begin, b.y_begin);
+        r.y_end = num::min(a.y_end, b.y_end);
 
-        rotate_blend_any(src, dst, src_pivot, dst_pivot, rot);
+        return r;
     }
 
 
-    void rotate_blend(ImageView const& src, SubView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot)
+    static Rect2Du32 offset_rect(Rect2Du32 const& r, u32 x, u32 y)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-
-        rotate_blend_any(src, dst, src_pivot, dst_pivot, rot);
+        return make_rect(r.x_begin - x, r.y_begin - y, r.x_end - r.x_begin, r.y_end - r.y_begin);
     }
 
 
-    void rotate_blend_transform(GraySubView const& src, SubView const& dst, Vec2Df32 cos_sin, fn<Pixel(u8)> const& func)
+    static Rect2Du32 circle_rect(CommandList const& list, Point2Di32 center, u32 radius)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
+        i32 const w = list.target.width;
+        i32 const h = list.target.height;
+        i32 const r = (i32)radius;
 
-        Point2Di32 sp = { (i32)src.width / 2, (i32)src.height / 2 };
-        Point2Di32 dp = { (i32)dst.width / 2, (i32)dst.height / 2 };
+        Rect2Du32 rect{};
+        rect.x_begin = (u32)num::clamp(center.x - r, 0, w);
+        rect.x_end = (u32)num::clamp(center.x + r + 1, 0, w);
+        rect.y_begin = (u32)num::clamp(center.y - r, 0, h);
+        rect.y_end = (u32)num::clamp(center.y + r + 1, 0, h);
 
-        rotate_blend_transform_any(src, dst, sp, dp, cos_sin.x, cos_sin.y, func);
+        return rect;
     }
-}
-
 
-/* flip */
 
-namespace image
-{
-    template <class VIEW_S, class VIEW_D>
-    static void flip_view_h(VIEW_S const& src, VIEW_D const& dst)
+    static Command* push_command(CommandList& list, CommandType type, Rect2Du32 const& dst)
     {
-        auto const w = src.width;
-        auto const h = src.height;
-        auto const w2 = w / 2;
+        if (dst.x_begin >= dst.x_end || dst.y_begin >= dst.y_end)
+        {
+            return 0;
+        }
 
-        for (u32 y = 0; y < h; y++)
+        if (list.commands.size_ == list.commands.capacity_)
         {
-            auto s = row_begin(src, y);
-            auto d = row_begin(dst, y);
-            for (u32 x = 0; x <= w2; x++)
-            {
-                auto end = w - 1 - x;
-                d[x] = s[end];
-                d[end] = s[x];
-            }
+            flush(list);
         }
+
+        auto cmd = mb::push_elements(list.commands, 1);
+        cmd->type = type;
+        cmd->dst = dst;
+
+        return cmd;
+    }
+
+
+    static Command* push_command(CommandList& list, CommandType type, SubView const& dst)
+    {
+        assert(dst.matrix_data_ == list.target.matrix_data_);
+        assert(dst.matrix_width == list.target.width);
+
+        return push_command(list, type, view_rect(dst));
     }
 
 
-    template <class VIEW_S, class VIEW_D>
-    static void flip_view_h_blend(VIEW_S const& src, VIEW_D const& dst)
+    static bool bin_commands(CommandList& list)
     {
-        auto const w = src.width;
-        auto const h = src.height;
-        auto const w2 = w / 2;
+        auto const n_tiles = list.n_tiles_x * list.n_tiles_y;
+        auto const ts = list.tile_size;
 
-        for (u32 y = 0; y < h; y++)
+        auto offsets = list.tile_offsets.data_;
+        for (u32 i = 0; i <= n_tiles; i++)
         {
-            auto s = row_begin(src, y);
-            auto d = row_begin(dst, y);
-            for (u32 x = 0; x <= w2; x++)
+            offsets[i] = 0;
+        }
+
+        auto const for_each_tile = [&](Command const& cmd, auto const& func)
+        {
+            auto const& r = cmd.dst;
+            for (u32 ty = r.y_begin / ts; ty <= (r.y_end - 1) / ts; ty++)
             {
-                auto end = w - 1 - x;
-                alpha_blend(s[end], d + x);
-                alpha_blend(s[x], d + end);
+                for (u32 tx = r.x_begin / ts; tx <= (r.x_end - 1) / ts; tx++)
+                {
+                    func(ty * list.n_tiles_x + tx);
+                }
             }
+        };
+
+        // count per tile, then prefix sum to find where each tile's list begins
+        for (u32 c = 0; c < list.commands.size_; c++)
+        {
+            for_each_tile(list.commands.data_[c], [&](u32 t) { offsets[t + 1]++; });
         }
-    }
 
+        for (u32 i = 0; i < n_tiles; i++)
+        {
+            offsets[i + 1] += offsets[i];
+        }
 
-    template <class VIEW_S, class VIEW_D>
-    static void flip_view_v(VIEW_S const& src, VIEW_D const& dst)
-    {
-        auto const w = src.width;
-        auto const h = src.height;
+        auto const n_entries = offsets[n_tiles];
+        if (n_entries > list.tile_commands.capacity_)
+        {
+            mb::destroy_buffer(list.tile_commands);
+            if (!mb::create_buffer(list.tile_commands, n_entries * 2, "tile_commands"))
+            {
+                return false;
+            }
+        }
 
-        for (u32 y = 0; y < h; y++)
+        // fill in command order, offsets[t] ends at the start of tile t + 1
+        auto ids = list.tile_commands.data_;
+        for (u32 c = 0; c < list.commands.size_; c++)
         {
-            sp::copy(row_span(src, y), row_span(dst, h - y - 1));
+            for_each_tile(list.commands.data_[c], [&](u32 t) { ids[offsets[t]++] = c; });
         }
-    }
 
+        for (u32 i = n_tiles; i > 0; i--)
+        {
+            offsets[i] = offsets[i - 1];
+        }
 
-    void flip_h(ImageView const& src, ImageView const& dst)
-    {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(src.width == dst.width);
-        assert(src.height == dst.height);
+        offsets[0] = 0;
 
-        flip_view_h(src, dst);
+        return true;
     }
 
 
-    void flip_h(ImageView const& src, SubView const& dst)
+    static void run_command(CommandList const& list, Command const& cmd, Rect2Du32 const& tile)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(src.width == dst.width);
-        assert(src.height == dst.height);
+        auto const r = clip_rect(cmd.dst, tile);
+        auto const dst = sub_view(list.target, r);
+        auto const s = offset_rect(r, cmd.dst.x_begin, cmd.dst.y_begin);
 
-        flip_view_h(src, dst);
-    }
+        Point2Di32 center = { cmd.center.x - (i32)r.x_begin, cmd.center.y - (i32)r.y_begin };
+
+        switch (cmd.type)
+        {
+        case CommandType::Fill:
+            for (u32 y = 0; y < dst.height; y++)
+            {
+                sp::fill_32(row_span(dst, y), cmd.color);
+            }
+            break;
 
+        case CommandType::FillBlend:
+            for (u32 y = 0; y < dst.height; y++)
+            {
+                alpha_blend_fill_span(row_span(dst, y), cmd.color);
+            }
+            break;
 
-    void flip_h(SubView const& src, ImageView const& dst)
-    {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(src.width == dst.width);
-        assert(src.height == dst.height);
+        case CommandType::Copy:
+        {
+            auto src = sub_view(cmd.src, s);
+            for (u32 y = 0; y < dst.height; y++)
+            {
+                sp::copy(row_span(src, y), row_span(dst, y));
+            }
+        } break;
 
-        flip_view_h(src, dst);
-    }
+        case CommandType::CopyBlend:
+            copy_blend_sub_view(sub_view(cmd.src, s), dst);
+            break;
 
+        case CommandType::Transform:
+            internal::transform_rows(sub_view(cmd.src, s), dst, 0, dst.height, cmd.func);
+            break;
 
-    void flip_h(SubView const& src, SubView const& dst)
-    {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(src.width == dst.width);
-        assert(src.height == dst.height);
+        case CommandType::TransformGray:
+            internal::transform_rows(sub_view(cmd.src_gray, s), dst, 0, dst.height, cmd.func_gray);
+            break;
+
+        case CommandType::CircleFill:
+            circle_fill_spans(dst, center, cmd.radius, cmd.color);
+            break;
 
-        flip_view_h(src, dst);
+        case CommandType::CircleOutline:
+            circle_outline_safe(dst, center, cmd.radius, cmd.color);
+            break;
+        }
     }
 
 
-    void flip_v(ImageView const& src, SubView const& dst)
+    static void run_tile(CommandList const& list, u32 tx, u32 ty)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(src.width == dst.width);
-        assert(src.height == dst.height);
+        auto const ts = list.tile_size;
+        auto const x = tx * ts;
+        auto const y = ty * ts;
+
+        auto tile = make_rect(x, y, num::min(ts, list.target.width - x), num::min(ts, list.target.height - y));
+
+        auto t = ty * list.n_tiles_x + tx;
+        auto begin = list.tile_offsets.data_[t];
+        auto end = list.tile_offsets.data_[t + 1];
 
-        flip_view_v(src, dst);
+        for (u32 i = begin; i < end; i++)
+        {
+            run_command(list, list.commands.data_[list.tile_commands.data_[i]], tile);
+        }
     }
 
 
-    void flip_h_blend(ImageView const& src, SubView const& dst)
+    static void run_commands(CommandList const& list, Rect2Du32 const& full)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(src.width == dst.width);
-        assert(src.height == dst.height);
-
-        flip_view_h_blend(src, dst);
+        for (u32 i = 0; i < list.commands.size_; i++)
+        {
+            run_command(list, list.commands.data_[i], full);
+        }
     }
 }
+}
 
 
-/* centroid */
-
 namespace image
 {
-    Point2Du32 centroid(ImageView const& view)
-	{		
-        assert(view.matrix_data_);
-        assert(view.width);
-        assert(view.height);
-        
-		f64 total = 0.0;
-		f64 x_total = 0.0;
-		f64 y_total = 0.0;
+namespace draw
+{
+    bool create_command_list(CommandList& list, ImageView const& target, u32 max_commands)
+    {
+        assert(target.matrix_data_);
+        assert(target.width);
+        assert(target.height);
 
-        auto const accumulate = [&](u32 x, u32 y)
+        auto const ts = list.tile_size;
+
+        list.target = target;
+        list.n_tiles_x = (target.width + ts - 1) / ts;
+        list.n_tiles_y = (target.height + ts - 1) / ts;
+
+        auto n_tiles = list.n_tiles_x * list.n_tiles_y;
+
+        if (!mb::create_buffer(list.commands, max_commands, "commands"))
         {
-            auto p = *xy_at(view, x, y);
-            u64 val = p.alpha ? 1 : 0;
-            total += val;
-            x_total += x * val;
-            y_total += y * val;
-        };
-        
-        for_each_xy(view, accumulate);
+            return false;
+        }
 
-		Point2Du32 pt{};
+        if (!mb::create_buffer(list.tile_offsets, n_tiles + 1, "tile_offsets"))
+        {
+            destroy_command_list(list);
+            return false;
+        }
 
-        if (total > 0.0)
+        if (!mb::create_buffer(list.tile_commands, max_commands * 4, "tile_commands"))
         {
-            pt.x = (u32)(x_total / total);
-			pt.y = (u32)(y_total / total);
+            destroy_command_list(list);
+            return false;
         }
-		else
-		{
-			pt.x = view.width / 2;
-			pt.y = view.height / 2;
-		}
 
-		return pt;
-	}
-}
+        return true;
+    }
 
 
-/* resize */
+    void destroy_command_list(CommandList& list)
+    {
+        mb::destroy_buffer(list.commands);
+        mb::destroy_buffer(list.tile_offsets);
+        mb::destroy_buffer(list.tile_commands);
+    }
 
-namespace image
-{
-    void scale_down(ImageView const& src, ImageView const& dst, u32 scale)
+
+    void flush(CommandList& list)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(src.width == scale * dst.width);
-        assert(src.height == scale * dst.height);
+        assert(list.commands.data_);
 
-        if (scale == 1)
+        if (!list.commands.size_)
         {
-            copy(src, dst);
             return;
         }
-        
-        f32 const i_scale = 1.0f / (scale * scale);
 
-        f32 red = 0.0f;
-        f32 green = 0.0f;
-        f32 blue = 0.0f;
-        f32 alpha = 0.0f;
-
-        for (u32 yd = 0; yd < dst.height; yd++)
+        if (bin_commands(list))
         {
-            auto ys = scale * yd;
-
-            auto rd = row_begin(dst, yd);            
-
-            for (u32 xd = 0; xd < dst.width; xd++)
+            exe::for_each_band(list.n_tiles_y, 1, [&](u32 ty_begin, u32 ty_end)
             {
-                auto xs = scale * xd;
-
-                red   = 0.0f;
-                green = 0.0f;
-                blue  = 0.0f;
-                alpha = 0.0f;
-
-                for (u32 v = 0; v < scale; v++)
+                for (u32 ty = ty_begin; ty < ty_end; ty++)
                 {
-                    auto rs = row_begin(src, ys + v) + xs;
-                    for (u32 u = 0; u < scale; u++)
+                    for (u32 tx = 0; tx < list.n_tiles_x; tx++)
                     {
-                        auto s = rs[u];
-                        red   += i_scale * s.red;
-                        green += i_scale * s.green;
-                        blue  += i_scale * s.blue;
-                        alpha += i_scale * s.alpha;
+                        run_tile(list, tx, ty);
                     }
                 }
-
-                auto& d = rd[xd];
-                d.red   = (u8)red;
-                d.green = (u8)green;
-                d.blue  = (u8)blue;
-                d.alpha = (u8)alpha;
-            }
+            });
+        }
+        else
+        {
+            // no memory for tile lists
+            run_commands(list, make_rect(list.target.width, list.target.height));
         }
+
+        mb::reset_buffer(list.commands);
     }
 
 
-    void scale_up(ImageView const& src, ImageView const& dst, u32 scale)
+    void fill(CommandList& list, SubView const& dst, Pixel color)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width * scale);
-        assert(dst.height == src.height * scale);
-
-        for (u32 ys = 0; ys < src.height; ys++)
+        auto cmd = push_command(list, CommandType::Fill, dst);
+        if (cmd)
         {
-            auto yd = scale * ys;
-            auto rs = row_begin(src, ys);
-
-            for (u32 xs = 0; xs < src.width; xs++)
-            {
-                auto xd = scale * xs;
+            cmd->color = color;
+        }
+    }
 
-                auto p = rs[xs];
 
-                for (u32 v = 0; v < scale; v++)
-                {
-                    auto rd = row_begin(dst, yd + v) + xd;
-                    for (u32 u = 0; u < scale; u++)
-                    {
-                        rd[u] = p;
-                    }
-                }
-            }
+    void fill_blend(CommandList& list, SubView const& dst, Pixel color)
+    {
+        auto cmd = push_command(list, CommandType::FillBlend, dst);
+        if (cmd)
+        {
+            cmd->color = color;
         }
     }
 
 
-    void scale_up(ImageView const& src, SubView const& dst, u32 scale)
+    void copy(CommandList& list, ImageView const& src, SubView const& dst)
+    {
+        copy(list, sub_view(src), dst);
+    }
+
+
+    void copy(CommandList& list, SubView const& src, SubView const& dst)
     {
         assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width * scale);
-        assert(dst.height == src.height * scale);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
 
-        for (u32 ys = 0; ys < src.height; ys++)
+        auto cmd = push_command(list, CommandType::Copy, dst);
+        if (cmd)
         {
-            auto yd = scale * ys;
-            auto rs = row_begin(src, ys);
+            cmd->src = src;
+        }
+    }
 
-            for (u32 xs = 0; xs < src.width; xs++)
-            {
-                auto xd = scale * xs;
 
-                auto p = rs[xs];
+    void copy_blend(CommandList& list, ImageView const& src, SubView const& dst)
+    {
+        copy_blend(list, sub_view(src), dst);
+    }
+
 
-                for (u32 v = 0; v < scale; v++)
-                {
-                    auto rd = row_begin(dst, yd + v) + xd;
-                    for (u32 u = 0; u < scale; u++)
-                    {
-                        rd[u] = p;
-                    }
-                }
-            }
+    void copy_blend(CommandList& list, SubView const& src, SubView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        auto cmd = push_command(list, CommandType::CopyBlend, dst);
+        if (cmd)
+        {
+            cmd->src = src;
         }
     }
 
 
-    bool resize(ImageView const& src, ImageView const& dst)
+    void transform(CommandList& list, SubView const& src, SubView const& dst, Pixel (*func)(Pixel, Pixel))
     {
-#ifdef IMAGE_RESIZE
-        assert(src.width);
-		assert(src.height);
-		assert(src.matrix_data_);
-		assert(dst.width);
-		assert(dst.height);
-        assert(dst.matrix_data_);
+        assert(src.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
 
-		int channels = 4;
-        auto layout = stbir_pixel_layout::STBIR_RGBA;
+        auto cmd = push_command(list, CommandType::Transform, dst);
+        if (cmd)
+        {
+            cmd->src = src;
+            cmd->func = func;
+        }
+    }
 
-		int width_src = (int)(src.width);
-		int height_src = (int)(src.height);
-		int stride_bytes_src = width_src * channels;
-        u8* data_src = (u8*)src.matrix_data_;
 
-		int width_dst = (int)(dst.width);
-		int height_dst = (int)(dst.height);
-		int stride_bytes_dst = width_dst * channels;
-        u8* data_dst = (u8*)dst.matrix_data_;
+    void transform(CommandList& list, GraySubView const& src, SubView const& dst, Pixel (*func)(u8, Pixel))
+    {
+        assert(src.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
 
-        auto data = stbir_resize_uint8_linear(
-			data_src, width_src, height_src, stride_bytes_src,
-			data_dst, width_dst, height_dst, stride_bytes_dst,
-			layout);
+        auto cmd = push_command(list, CommandType::TransformGray, dst);
+        if (cmd)
+        {
+            cmd->src_gray = src;
+            cmd->func_gray = func;
+        }
+    }
 
-		assert(data && " *** stbir_resize_uint8_linear() failed *** ");
 
-        if (!data)
+    void circle_fill(CommandList& list, Point2Di32 center, u32 radius, Pixel color)
+    {
+        auto cmd = push_command(list, CommandType::CircleFill, circle_rect(list, center, radius));
+        if (cmd)
         {
-            return false;
+            cmd->center = center;
+            cmd->radius = radius;
+            cmd->color = color;
         }
+    }
 
-		return true;
-#else
-
-        assert(false && " *** IMAGE_RESIZE not enabled *** ");
-        return false;
 
-#endif
+    void circle_outline(CommandList& list, Point2Di32 center, u32 radius, Pixel color)
+    {
+        auto cmd = push_command(list, CommandType::CircleOutline, circle_rect(list, center, radius));
+        if (cmd)
+        {
+            cmd->center = center;
+            cmd->radius = radius;
+            cmd->color = color;
+        }
     }
 }
+}
 
 
 /* read write */
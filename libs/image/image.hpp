@@ -2,6 +2,8 @@
 
 #include "../span/span.hpp"
 
+#include <type_traits>
+
 
 /*  image basic */
 
@@ -76,6 +78,62 @@ namespace image
 }
 
 
+/* premultiplied */
+
+namespace image
+{
+    // red, green and blue already multiplied by alpha
+    class RGBAu8PM
+    {
+    public:
+        u8 red;
+        u8 green;
+        u8 blue;
+        u8 alpha;
+    };
+
+    using PixelPM = RGBAu8PM;
+    using ImageViewPM = MatrixView2D<PixelPM>;
+    using SubViewPM = MatrixSubView2D<PixelPM>;
+
+
+    constexpr inline u8 mul_div255(u32 a, u32 b)
+    {
+        // round(a * b / 255)
+        u32 x = a * b + 128;
+        return (u8)((x + (x >> 8)) >> 8);
+    }
+
+
+    constexpr inline PixelPM to_premultiplied(Pixel p)
+    {
+        PixelPM pm{};
+        pm.red = mul_div255(p.red, p.alpha);
+        pm.green = mul_div255(p.green, p.alpha);
+        pm.blue = mul_div255(p.blue, p.alpha);
+        pm.alpha = p.alpha;
+
+        return pm;
+    }
+
+
+    constexpr inline Pixel to_straight(PixelPM pm)
+    {
+        u32 const a = pm.alpha;
+
+        auto const div = [a](u32 c) { return (u8)(c >= a ? 255 : (c * 255 + a / 2) / a); };
+
+        Pixel p{};
+        p.red = a ? div(pm.red) : 0;
+        p.green = a ? div(pm.green) : 0;
+        p.blue = a ? div(pm.blue) : 0;
+        p.alpha = pm.alpha;
+
+        return p;
+    }
+}
+
+
 namespace image
 {
     using Buffer8 = MemoryBuffer<u8>;
@@ -147,6 +205,52 @@ namespace image
 }
 
 
+/* execution */
+
+namespace image
+{
+    // Row band threading for fill, copy, transform, scale, rotate_90/180/270 and flip.
+    // The destination is split into at most n_threads bands of at least min_rows rows.
+    // Callbacks passed to transform must be safe to call from several threads.
+    class Execution
+    {
+    public:
+        u32 n_threads = 1;
+        u32 min_rows = 64;
+    };
+
+
+    u32 hardware_threads();
+
+    Execution get_execution();
+
+    void set_execution(Execution const& ex);
+
+    // Splits n_rows into bands for the current execution and calls func once per band.
+    // Bands run on the calling thread when there are too few rows to split.
+    void for_each_band(u32 n_rows, fn<void(u32 y_begin, u32 y_end)> const& func);
+
+
+    class ExecutionScope
+    {
+    public:
+        ExecutionScope(Execution const& ex)
+        {
+            prev_ = get_execution();
+            set_execution(ex);
+        }
+
+        ~ExecutionScope()
+        {
+            set_execution(prev_);
+        }
+
+    private:
+        Execution prev_;
+    };
+}
+
+
 /* make_view */
 
 namespace image
@@ -234,7 +338,7 @@ namespace image
     template <typename T>
     inline MatrixSubView2D<T> sub_view(MatrixView2D<T> const& view)
     {
-        auto range = make_range(view.width, view.height);
+        auto range = make_rect(view.width, view.height);
         return sub_view(view, range);
     }
 
@@ -286,6 +390,25 @@ namespace image
 }
 
 
+/* blend mode */
+
+namespace image
+{
+    // how a source pixel, weighted by its alpha, is combined with the destination
+    // every mode other than Alpha keeps the destination alpha
+    enum class BlendMode : u8
+    {
+        Alpha,      // source over
+        Add,        // d + s
+        Multiply,   // d * s
+        Screen,     // 1 - (1 - d) * (1 - s)
+        Darken,     // min(d, s)
+        Lighten,    // max(d, s)
+        Subtract,   // d - s
+    };
+}
+
+
 /* fill */
 
 namespace image
@@ -294,10 +417,16 @@ namespace image
 
     void fill(SubView const& view, Pixel color);
 
+    void fill(GrayView const& view, u8 gray);
+
+    void fill(GraySubView const& view, u8 gray);
+
     void fill_if(GraySubView const& view, u8 gray, fn<bool(u8)> const& pred);
 
     void fill_blend(SubView const& view, Pixel color);
 
+    void fill_blend(SubView const& view, Pixel color, BlendMode mode);
+
 
     void fill_row(SubView const& view, u32 y, Pixel color);
 
@@ -323,6 +452,37 @@ namespace image
     void copy_blend(SubView const& src, ImageView const& dst);
 
     void copy_blend(SubView const& src, SubView const& dst);
+
+
+    void copy_blend(ImageViewPM const& src, SubView const& dst);
+
+    void copy_blend(SubViewPM const& src, ImageView const& dst);
+
+    void copy_blend(SubViewPM const& src, SubView const& dst);
+
+
+    void copy_blend(ImageView const& src, SubView const& dst, BlendMode mode);
+
+    void copy_blend(SubView const& src, ImageView const& dst, BlendMode mode);
+
+    void copy_blend(SubView const& src, SubView const& dst, BlendMode mode);
+
+    void copy_blend(ImageViewPM const& src, SubView const& dst, BlendMode mode);
+
+    void copy_blend(SubViewPM const& src, ImageView const& dst, BlendMode mode);
+
+    void copy_blend(SubViewPM const& src, SubView const& dst, BlendMode mode);
+}
+
+
+/* premultiply */
+
+namespace image
+{
+    void premultiply(ImageView const& src, ImageViewPM const& dst);
+
+    // converts in place, the returned view shares memory with view
+    ImageViewPM premultiply(ImageView const& view);
 }
 
 
@@ -397,6 +557,249 @@ namespace image
 }
 
 
+/* mask rle */
+
+namespace image
+{
+    class MaskRun
+    {
+    public:
+        u32 x_begin;
+        u32 x_end;
+        u8 value;
+    };
+
+
+    // Non-zero runs of a mask, row by row. Zero is transparent and is not stored.
+    class MaskRLE
+    {
+    public:
+        u32 width = 0;
+        u32 height = 0;
+
+        MemoryBuffer<u32> row_offsets;
+        MemoryBuffer<MaskRun> runs;
+    };
+
+
+    bool create_mask_rle(MaskRLE& rle, GrayView const& mask);
+
+    void destroy_mask_rle(MaskRLE& rle);
+
+
+    void fill(MaskRLE const& mask, SubView const& dst, Pixel color);
+
+    void fill(MaskRLE const& mask, Rect2Du32 const& range, SubView const& dst, Pixel color);
+
+    // func is called once per run
+    void transform(MaskRLE const& mask, SubView const& dst, fn<Pixel(u8)> const& func);
+
+    void transform(MaskRLE const& mask, Rect2Du32 const& range, SubView const& dst, fn<Pixel(u8)> const& func);
+
+
+    void fill(MaskRLE const& mask, Rect2Du32 const& range, GraySubView const& dst, u8 gray);
+
+    void transform(MaskRLE const& mask, Rect2Du32 const& range, GraySubView const& dst, fn<u8(u8)> const& func);
+}
+
+
+/* inline functor overloads */
+
+namespace image
+{
+namespace internal
+{
+    template <typename T>
+    inline T* view_row(MatrixView2D<T> const& view, u32 y)
+    {
+        return view.matrix_data_ + (u64)y * view.width;
+    }
+
+
+    template <typename T>
+    inline T* view_row(MatrixSubView2D<T> const& view, u32 y)
+    {
+        return view.matrix_data_ + (u64)(view.y_begin + y) * view.matrix_width + view.x_begin;
+    }
+
+
+    template <class VIEW, class FUNC>
+    inline void for_each_pixel_rows(VIEW const& view, FUNC const& func)
+    {
+        for (u32 y = 0; y < view.height; y++)
+        {
+            auto s = internal::view_row(view, y);
+            for (u32 x = 0; x < view.width; x++)
+            {
+                func(s[x]);
+            }
+        }
+    }
+
+
+    template <class VIEW, class FUNC>
+    inline void for_each_xy_rows(VIEW const& view, FUNC const& xy_func)
+    {
+        using R = decltype(xy_func(0u, 0u));
+
+        for (u32 y = 0; y < view.height; y++)
+        {
+            auto d = internal::view_row(view, y);
+            for (u32 x = 0; x < view.width; x++)
+            {
+                if constexpr (std::is_void_v<R>)
+                {
+                    xy_func(x, y);
+                }
+                else
+                {
+                    d[x] = xy_func(x, y);
+                }
+            }
+        }
+    }
+
+
+    template <class V_SRC, class V_DST, class FUNC>
+    inline void transform_rows(V_SRC const& src, V_DST const& dst, u32 y_begin, u32 y_end, FUNC const& func)
+    {
+        using S = decltype(src.matrix_data_[0]);
+        using D = decltype(dst.matrix_data_[0]);
+
+        constexpr auto has_dst = std::is_invocable_v<FUNC, S, D>;
+
+        // pixel writes may alias the views, read the width once
+        auto const width = src.width;
+
+        for (u32 y = y_begin; y < y_end; y++)
+        {
+            auto s = internal::view_row(src, y);
+            auto d = internal::view_row(dst, y);
+            for (u32 x = 0; x < width; x++)
+            {
+                if constexpr (has_dst)
+                {
+                    d[x] = func(s[x], d[x]);
+                }
+                else
+                {
+                    d[x] = func(s[x]);
+                }
+            }
+        }
+    }
+
+
+    template <class V_SRC, class V_DST, class FUNC>
+    inline void transform_bands(V_SRC const& src, V_DST const& dst, FUNC const& func)
+    {
+        auto const band = [&](u32 y_begin, u32 y_end)
+        {
+            transform_rows(src, dst, y_begin, y_end, func);
+        };
+
+        // std::cref keeps fn<> from copying the lambda to the heap
+        for_each_band(dst.height, std::cref(band));
+    }
+}
+}
+
+
+namespace image
+{
+    // Chosen over the fn<> overloads for lambdas and function pointers so the call is inlined.
+    // transform is split into row bands like the fn<> overloads.
+    // for_each_pixel and for_each_xy run on the calling thread.
+
+    template <typename T, class FUNC>
+    inline void for_each_pixel(MatrixView2D<T> const& view, FUNC const& func)
+    {
+        assert(view.matrix_data_);
+
+        internal::for_each_pixel_rows(view, func);
+    }
+
+
+    template <typename T, class FUNC>
+    inline void for_each_pixel(MatrixSubView2D<T> const& view, FUNC const& func)
+    {
+        assert(view.matrix_data_);
+
+        internal::for_each_pixel_rows(view, func);
+    }
+
+
+    template <typename T, class FUNC>
+    inline void for_each_xy(MatrixView2D<T> const& view, FUNC const& xy_func)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        internal::for_each_xy_rows(view, xy_func);
+    }
+
+
+    template <typename T, class FUNC>
+    inline void for_each_xy(MatrixSubView2D<T> const& view, FUNC const& xy_func)
+    {
+        assert(view.matrix_data_);
+        assert(view.width);
+        assert(view.height);
+
+        internal::for_each_xy_rows(view, xy_func);
+    }
+
+
+    template <typename S, typename D, class FUNC>
+    inline void transform(MatrixView2D<S> const& src, MatrixView2D<D> const& dst, FUNC const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        internal::transform_bands(src, dst, func);
+    }
+
+
+    template <typename S, typename D, class FUNC>
+    inline void transform(MatrixView2D<S> const& src, MatrixSubView2D<D> const& dst, FUNC const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        internal::transform_bands(src, dst, func);
+    }
+
+
+    template <typename S, typename D, class FUNC>
+    inline void transform(MatrixSubView2D<S> const& src, MatrixView2D<D> const& dst, FUNC const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        internal::transform_bands(src, dst, func);
+    }
+
+
+    template <typename S, typename D, class FUNC>
+    inline void transform(MatrixSubView2D<S> const& src, MatrixSubView2D<D> const& dst, FUNC const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        internal::transform_bands(src, dst, func);
+    }
+}
+
+
 /* circle */
 
 namespace image
@@ -410,6 +813,84 @@ namespace draw
     void circle_fill(ImageView const& view, Point2Di32 center, u32 radius, Pixel color);
 
     void circle_fill(SubView const& view, Point2Di32 center, u32 radius, Pixel color);
+
+
+    void circle_outline(GrayView const& view, Point2Di32 center, u32 radius, u8 gray);
+
+    void circle_outline(GraySubView const& view, Point2Di32 center, u32 radius, u8 gray);
+
+    void circle_fill(GrayView const& view, Point2Di32 center, u32 radius, u8 gray);
+
+    void circle_fill(GraySubView const& view, Point2Di32 center, u32 radius, u8 gray);
+}
+}
+
+
+/* shapes */
+
+namespace image
+{
+namespace draw
+{
+    // thickness 1 draws a Bresenham line, thicker lines are filled as a quad
+    void line(ImageView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, Pixel color);
+
+    void line(SubView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, Pixel color);
+
+    void line_blend(ImageView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, Pixel color);
+
+    void line_blend(SubView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, Pixel color);
+
+
+    // thickness grows inward from the rect edges
+    void rect_outline(ImageView const& view, Rect2Du32 const& rect, u32 thickness, Pixel color);
+
+    void rect_outline(SubView const& view, Rect2Du32 const& rect, u32 thickness, Pixel color);
+
+    void rect_outline_blend(ImageView const& view, Rect2Du32 const& rect, u32 thickness, Pixel color);
+
+    void rect_outline_blend(SubView const& view, Rect2Du32 const& rect, u32 thickness, Pixel color);
+
+
+    // pixels are filled when their center is inside the shape
+    void triangle_fill(ImageView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, Pixel color);
+
+    void triangle_fill(SubView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, Pixel color);
+
+    void triangle_fill_blend(ImageView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, Pixel color);
+
+    void triangle_fill_blend(SubView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, Pixel color);
+
+
+    // polygons with more points are not drawn
+    constexpr u32 POLYGON_MAX_POINTS = 64;
+
+    // points must describe a convex polygon, in either winding
+    void polygon_fill(ImageView const& view, SpanView<Point2Di32> const& points, Pixel color);
+
+    void polygon_fill(SubView const& view, SpanView<Point2Di32> const& points, Pixel color);
+
+    void polygon_fill_blend(ImageView const& view, SpanView<Point2Di32> const& points, Pixel color);
+
+    void polygon_fill_blend(SubView const& view, SpanView<Point2Di32> const& points, Pixel color);
+
+
+    // gray targets (palette indices) have no blend versions
+    void line(GrayView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, u8 gray);
+
+    void line(GraySubView const& view, Point2Di32 p0, Point2Di32 p1, u32 thickness, u8 gray);
+
+    void rect_outline(GrayView const& view, Rect2Du32 const& rect, u32 thickness, u8 gray);
+
+    void rect_outline(GraySubView const& view, Rect2Du32 const& rect, u32 thickness, u8 gray);
+
+    void triangle_fill(GrayView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, u8 gray);
+
+    void triangle_fill(GraySubView const& view, Point2Di32 p0, Point2Di32 p1, Point2Di32 p2, u8 gray);
+
+    void polygon_fill(GrayView const& view, SpanView<Point2Di32> const& points, u8 gray);
+
+    void polygon_fill(GraySubView const& view, SpanView<Point2Di32> const& points, u8 gray);
 }
 }
 
@@ -447,6 +928,19 @@ namespace image
 
     void rotate_blend(ImageView const& src, SubView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot);
 
+    void rotate_blend(ImageViewPM const& src, ImageView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot);
+
+    void rotate_blend(ImageViewPM const& src, SubView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot);
+
+
+    void rotate_blend(ImageView const& src, ImageView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot, BlendMode mode);
+
+    void rotate_blend(ImageView const& src, SubView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot, BlendMode mode);
+
+    void rotate_blend(ImageViewPM const& src, ImageView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot, BlendMode mode);
+
+    void rotate_blend(ImageViewPM const& src, SubView const& dst, Point2Di32 src_pivot, Point2Di32 dst_pivot, uangle rot, BlendMode mode);
+
 
     void rotate_blend_transform(GraySubView const& src, SubView const& dst, Vec2Df32 cos_sin, fn<Pixel(u8)> const& func);
 }
@@ -472,9 +966,98 @@ namespace image
 }
 
 
+/* stats */
+
 namespace image
 {
+namespace stats
+{
+    class Histogram
+    {
+    public:
+        u32 red[256];
+        u32 green[256];
+        u32 blue[256];
+        u32 alpha[256];
+    };
+
+
+    class GrayHistogram
+    {
+    public:
+        u32 counts[256];
+    };
+
+
+    // per channel, mean is rounded to nearest
+    class ColorStats
+    {
+    public:
+        Pixel min;
+        Pixel max;
+        Pixel mean;
+    };
+
+
+    class GrayStats
+    {
+    public:
+        u8 min;
+        u8 max;
+        u8 mean;
+    };
+
+
+    void histogram(ImageView const& view, Histogram& hist);
+
+    void histogram(SubView const& view, Histogram& hist);
+
+    void histogram(GrayView const& view, GrayHistogram& hist);
+
+    void histogram(GraySubView const& view, GrayHistogram& hist);
+
+
+    ColorStats min_max_mean(ImageView const& view);
+
+    ColorStats min_max_mean(SubView const& view);
+
+    GrayStats min_max_mean(GrayView const& view);
+
+    GrayStats min_max_mean(GraySubView const& view);
+
+
+    // Coverage is alpha > 0 for Pixels and value > 0 for gray.
+    // bounds is empty and centroid is the view center when nothing is covered.
+    u64 count_coverage(ImageView const& view);
+
+    u64 count_coverage(SubView const& view);
+
+    u64 count_coverage(GrayView const& view);
+
+    u64 count_coverage(GraySubView const& view);
+
+    Rect2Du32 coverage_bounds(ImageView const& view);
+
+    Rect2Du32 coverage_bounds(SubView const& view);
+
+    Rect2Du32 coverage_bounds(GrayView const& view);
+
+    Rect2Du32 coverage_bounds(GraySubView const& view);
+
     Point2Du32 centroid(ImageView const& view);
+
+    Point2Du32 centroid(SubView const& view);
+
+    Point2Du32 centroid(GrayView const& view);
+
+    Point2Du32 centroid(GraySubView const& view);
+}
+
+
+    inline Point2Du32 centroid(ImageView const& view)
+    {
+        return stats::centroid(view);
+    }
 }
 
 
@@ -484,14 +1067,243 @@ namespace image
 {
     void scale_down(ImageView const& src, ImageView const& dst, u32 scale);
 
+    void scale_down(SubView const& src, SubView const& dst, u32 scale);
+
     void scale_up(ImageView const& src, ImageView const& dst, u32 scale);
 
     void scale_up(ImageView const& src, SubView const& dst, u32 scale);
 
+    void scale_up(SubView const& src, SubView const& dst, u32 scale);
+
     bool resize(ImageView const& src, ImageView const& dst);
 }
 
 
+/* palette */
+
+namespace image
+{
+    // Indexed color: a GrayView of palette indices is drawn with the gray overloads
+    // and expanded to Pixels only when scaled to the output.
+    // Gray overloads cover fill, MaskRLE fill/transform, circles and the shapes.
+    // Blending, nine slice and the command list are Pixel only.
+    class Palette
+    {
+    public:
+        static constexpr u32 count = 256;
+
+        Pixel colors[count];
+    };
+
+
+    void expand(GrayView const& src, ImageView const& dst, Palette const& palette);
+
+    void scale_up(GrayView const& src, ImageView const& dst, u32 scale, Palette const& palette);
+
+    void scale_up(GrayView const& src, SubView const& dst, u32 scale, Palette const& palette);
+
+    void scale_up(GraySubView const& src, SubView const& dst, u32 scale, Palette const& palette);
+}
+
+
+/* pyramid */
+
+namespace image
+{
+    // Power of two levels of one image in a single buffer.
+    // Level 0 is a copy of the source, each level is a 2x2 box filter of the one above.
+    // Level sizes are halved rounding down, an odd last row or column is averaged into the level's last row or column.
+    class Pyramid
+    {
+    public:
+        static constexpr u32 max_levels = 16;
+
+        ImageView levels[max_levels];
+        u32 n_levels = 0;
+
+        Buffer32 buffer;
+    };
+
+
+    bool create_pyramid(Pyramid& pyramid, ImageView const& src);
+
+    void destroy_pyramid(Pyramid& pyramid);
+
+    // rebuild the levels after the source changed, src must match level 0
+    void update_pyramid(Pyramid& pyramid, ImageView const& src);
+
+    // smallest level at least width x height, or level 0
+    u32 select_level(Pyramid const& pyramid, u32 width, u32 height);
+
+    // nearest sample from the selected level, box filtered when the sizes divide evenly
+    void sample(Pyramid const& pyramid, ImageView const& dst);
+
+    void sample(Pyramid const& pyramid, SubView const& dst);
+}
+
+
+/* blur */
+
+namespace image
+{
+    constexpr u32 MAX_BLUR_RADIUS = 127;
+
+    // Each pass blurs rows and writes them transposed, first into scratch and then into dst.
+    // scratch is reset and needs room for width * height elements. Edges are clamped.
+    // src and dst can be the same view.
+    void blur_box(ImageView const& src, ImageView const& dst, u32 radius, Buffer32& scratch);
+
+    void blur_box(SubView const& src, SubView const& dst, u32 radius, Buffer32& scratch);
+
+    void blur_box(GrayView const& src, GrayView const& dst, u32 radius, Buffer8& scratch);
+
+    void blur_box(GraySubView const& src, GraySubView const& dst, u32 radius, Buffer8& scratch);
+
+
+    // three box passes sized for sigma
+    void blur_gaussian(ImageView const& src, ImageView const& dst, f32 sigma, Buffer32& scratch);
+
+    void blur_gaussian(SubView const& src, SubView const& dst, f32 sigma, Buffer32& scratch);
+
+    void blur_gaussian(GrayView const& src, GrayView const& dst, f32 sigma, Buffer8& scratch);
+
+    void blur_gaussian(GraySubView const& src, GraySubView const& dst, f32 sigma, Buffer8& scratch);
+}
+
+
+/* color lut */
+
+namespace image
+{
+    // one 256 entry table per channel
+    class ColorLUT
+    {
+    public:
+        u8 red[256];
+        u8 green[256];
+        u8 blue[256];
+        u8 alpha[256];
+    };
+
+
+    ColorLUT make_lut_identity();
+
+    // rgb only, alpha is unchanged by the helpers below
+    ColorLUT make_lut_gamma(f32 gamma);
+
+    ColorLUT make_lut_brightness(i32 offset);
+
+    // scales rgb away from or toward 128
+    ColorLUT make_lut_contrast(f32 contrast);
+
+    // multiplies rgb by color
+    ColorLUT make_lut_tint(Pixel color);
+
+    // blends rgb toward color, t = 0 is unchanged and t = 1 is color
+    ColorLUT make_lut_fade(Pixel color, f32 t);
+
+    // applies first, then second
+    ColorLUT combine(ColorLUT const& first, ColorLUT const& second);
+
+
+    void apply_lut(ImageView const& view, ColorLUT const& lut);
+
+    void apply_lut(SubView const& view, ColorLUT const& lut);
+
+    void copy_lut(ImageView const& src, ImageView const& dst, ColorLUT const& lut);
+
+    void copy_lut(ImageView const& src, SubView const& dst, ColorLUT const& lut);
+
+    void copy_lut(SubView const& src, SubView const& dst, ColorLUT const& lut);
+}
+
+
+/* nine slice */
+
+namespace image
+{
+namespace draw
+{
+    // source borders that keep their size
+    class NineSliceInsets
+    {
+    public:
+        u32 left = 0;
+        u32 top = 0;
+        u32 right = 0;
+        u32 bottom = 0;
+    };
+
+
+    // corners are copied, edges and center are tiled to fill dst, nothing is resampled
+    void nine_slice(ImageView const& src, NineSliceInsets const& insets, SubView const& dst);
+
+    void nine_slice(SubView const& src, NineSliceInsets const& insets, SubView const& dst);
+
+    void nine_slice_blend(ImageView const& src, NineSliceInsets const& insets, SubView const& dst);
+
+    void nine_slice_blend(SubView const& src, NineSliceInsets const& insets, SubView const& dst);
+}
+}
+
+
+/* command list */
+
+namespace image
+{
+namespace draw
+{
+    class Command;
+
+
+    // Records draws to one target and replays them 64x64 tile by tile on flush.
+    // Sources must not overlap the target. Tile rows are split among the execution threads.
+    class CommandList
+    {
+    public:
+        static constexpr u32 tile_size = 64;
+
+        ImageView target;
+
+        u32 n_tiles_x = 0;
+        u32 n_tiles_y = 0;
+
+        MemoryBuffer<Command> commands;
+        MemoryBuffer<u32> tile_offsets;
+        MemoryBuffer<u32> tile_commands;
+    };
+
+
+    bool create_command_list(CommandList& list, ImageView const& target, u32 max_commands);
+
+    void destroy_command_list(CommandList& list);
+
+    void flush(CommandList& list);
+
+
+    void fill(CommandList& list, SubView const& dst, Pixel color);
+
+    void fill_blend(CommandList& list, SubView const& dst, Pixel color);
+
+    void copy(CommandList& list, ImageView const& src, SubView const& dst);
+
+    void copy(CommandList& list, SubView const& src, SubView const& dst);
+
+    void copy_blend(CommandList& list, ImageView const& src, SubView const& dst);
+
+    void copy_blend(CommandList& list, SubView const& src, SubView const& dst);
+
+    void transform(CommandList& list, SubView const& src, SubView const& dst, Pixel (*func)(Pixel, Pixel));
+
+    void transform(CommandList& list, GraySubView const& src, SubView const& dst, Pixel (*func)(u8, Pixel));
+
+    void circle_fill(CommandList& list, Point2Di32 center, u32 radius, Pixel color);
+
+    void circle_outline(CommandList& list, Point2Di32 center, u32 radius, Pixel color);
+}
+}
+
+
 /* read write */
 
 namespace image
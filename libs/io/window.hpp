@@ -29,8 +29,23 @@ namespace window
         u32 width_px = 0;
         u32 height_px = 0;
 
+        // the texture is pixel_scale times pixel_buffer, scaled up on render
+        u32 pixel_scale = 1;
+
         u64 handle = 0;
     };
+
+
+    // window texture memory locked for one frame, rows are pitch_px pixels apart
+    class FrameBuffer
+    {
+    public:
+
+        u32* pixel_data = 0;
+        u32 width_px = 0;
+        u32 height_px = 0;
+        u32 pitch_px = 0;
+    };
 }
 
 
@@ -48,12 +63,34 @@ namespace window
 
     bool create_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size);
 
+    // pixel_buffer is pixel_size (the virtual resolution), each pixel is drawn as pixel_scale x pixel_scale
+    bool create(Window& window, cstr title, Vec2Du32 window_size, Vec2Du32 pixel_size, u32 pixel_scale, Icon64 const& icon);
+
+    bool create(Window& window, cstr title, Vec2Du32 window_size, Vec2Du32 pixel_size, u32 pixel_scale);
+
+    bool create_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size, u32 pixel_scale, Icon64 const& icon);
+
+    bool create_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size, u32 pixel_scale);
+
     void destroy(Window& window);
 
     bool resize_pixel_buffer(Window& window, u32 width, u32 height);
 
     void render(Window const& window, b32 size_changed = 0);
 
+    // uploads only the dirty regions of pixel_buffer, the texture keeps the rest
+    void render(Window const& window, Rect2Du32 const* dirty, u32 n_dirty, b32 size_changed = 0);
+
+    // uploads the 64x64 tiles of pixel_buffer that changed since the last render_changed
+    void render_changed(Window const& window, b32 size_changed = 0);
+
+    // Draw straight into the window texture instead of pixel_buffer, no copy on render.
+    // The texture is not kept between frames, every pixel must be written before render_frame.
+    // The frame is the texture size, pixel_scale times pixel_buffer.
+    bool lock_frame(Window const& window, FrameBuffer& frame);
+
+    void render_frame(Window const& window, b32 size_changed = 0);
+
     void hide_mouse_cursor();
 
     void show_mouse_cursor();
@@ -4,6 +4,11 @@
 #include "../alloc_type/alloc_type.hpp"
 #include "sdl_include.hpp"
 
+#ifdef __AVX2__
+#define WINDOW_SIMD_256
+#include <immintrin.h>
+#endif
+
 
 /* screen memory */
 
@@ -20,11 +25,27 @@ namespace sdl
 
         u32 width_px = 0;
         u32 height_px = 0;
+
+        // texture pixels per pixel_buffer pixel
+        u32 pixel_scale = 1;
+
+        b32 is_locked = 0;
+
+        // render_changed
+        u64* tile_hashes = 0;
+        u32 n_tiles_x = 0;
+        u32 n_tiles_y = 0;
+        b32 tiles_valid = 0;
     };
 
 
     static void destroy_screen_memory(ScreenMemory& screen)
     {
+        if (screen.tile_hashes)
+        {
+            mem::free(screen.tile_hashes);
+        }
+
         if (screen.texture)
         {
             SDL_DestroyTexture(screen.texture);
@@ -113,6 +134,8 @@ namespace sdl
 
         screen.width_px = width;
         screen.height_px = height;
+        screen.is_locked = 0;
+        screen.tiles_valid = 0;
 
         return true;
     }
@@ -245,7 +268,13 @@ namespace sdl
 
 namespace window
 {    
-    static bool create_window_memory(Window& window, cstr title, Vec2Du32 window_size, Vec2Du32 pixel_size)
+    static Vec2Du32 scale_size(Vec2Du32 pixel_size, u32 pixel_scale)
+    {
+        return { pixel_size.x * pixel_scale, pixel_size.y * pixel_scale };
+    }
+
+
+    static bool create_window_memory(Window& window, cstr title, Vec2Du32 window_size, Vec2Du32 pixel_size, u32 pixel_scale)
     {
         auto data = sdl::allocate_screen_memory();
         if (!data)
@@ -255,11 +284,12 @@ namespace window
 
         auto& screen = *data;
 
-        if (!sdl::create_screen_memory(screen, title, window_size, pixel_size))
+        if (!sdl::create_screen_memory(screen, title, window_size, scale_size(pixel_size, pixel_scale)))
         {
             return false;
         }
 
+        screen.pixel_scale = pixel_scale;
         sdl::set_out_rect(screen);
 
         window.handle = (u64)data;
@@ -268,7 +298,7 @@ namespace window
     }
 
 
-    static bool create_window_memory_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size)
+    static bool create_window_memory_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size, u32 pixel_scale)
     {
         auto data = sdl::allocate_screen_memory();
         if (!data)
@@ -278,11 +308,12 @@ namespace window
 
         auto& screen = *data;
 
-        if (!sdl::create_screen_memory_fullscreen(screen, title, pixel_size))
+        if (!sdl::create_screen_memory_fullscreen(screen, title, scale_size(pixel_size, pixel_scale)))
         {
             return false;
         }
 
+        screen.pixel_scale = pixel_scale;
         sdl::set_out_rect(screen);
 
         window.handle = (u64)data;
@@ -323,6 +354,322 @@ namespace window
             dst += dst_pitch;
         }
     }
+
+
+    static void scale_row_n(u32 const* s, u32* d, u32 width, u32 scale)
+    {
+        for (u32 x = 0; x < width; x++)
+        {
+            auto p = s[x];
+            for (u32 u = 0; u < scale; u++)
+            {
+                d[u] = p;
+            }
+
+            d += scale;
+        }
+    }
+
+
+#ifdef WINDOW_SIMD_256
+
+    template <u32 SCALE>
+    static void scale_row(u32 const* s, u32* d, u32 width)
+    {
+        static_assert(SCALE >= 2 && SCALE <= 4);
+
+        constexpr u32 N = 8;
+
+        // permute indices for each group of 8 destination pixels
+        __m256i perm[SCALE];
+        for (u32 i = 0; i < SCALE; i++)
+        {
+            constexpr i32 S = (i32)SCALE;
+            auto b = (i32)(i * N);
+
+            perm[i] = _mm256_setr_epi32(
+                b / S, (b + 1) / S, (b + 2) / S, (b + 3) / S, 
+                (b + 4) / S, (b + 5) / S, (b + 6) / S, (b + 7) / S);
+        }
+
+        u32 x = 0;
+        for (; x + N <= width; x += N)
+        {
+            auto p8 = _mm256_loadu_si256((__m256i const*)(s + x));
+            for (u32 i = 0; i < SCALE; i++)
+            {
+                _mm256_storeu_si256((__m256i*)(d + i * N), _mm256_permutevar8x32_epi32(p8, perm[i]));
+            }
+
+            d += SCALE * N;
+        }
+
+        scale_row_n(s + x, d, width - x, SCALE);
+    }
+
+#else
+
+    template <u32 SCALE>
+    static void scale_row(u32 const* s, u32* d, u32 width)
+    {
+        scale_row_n(s, d, width, SCALE);
+    }
+
+#endif
+
+
+    static void scale_row(u32 const* s, u32* d, u32 width, u32 scale)
+    {
+        switch (scale)
+        {
+        case 1:
+            SDL_memcpy(d, s, width * sizeof(u32));
+            break;
+
+        case 2:
+            scale_row<2>(s, d, width);
+            break;
+
+        case 3:
+            scale_row<3>(s, d, width);
+            break;
+
+        case 4:
+            scale_row<4>(s, d, width);
+            break;
+
+        default:
+            scale_row_n(s, d, width, scale);
+            break;
+        }
+    }
+
+
+    static void copy_window_pixels_scaled(Window const& window, Rect2Du32 r, u32 scale, void* dst_data, int dst_pitch)
+    {
+        // texture memory can be write-combined, each row is expanded again instead of read back
+        auto w = r.x_end - r.x_begin;
+        auto dst = (u8*)dst_data;
+
+        for (u32 y = r.y_begin; y < r.y_end; y++)
+        {
+            auto src = window.pixel_buffer + (u64)y * window.width_px + r.x_begin;
+
+            for (u32 v = 0; v < scale; v++)
+            {
+                scale_row(src, (u32*)dst, w, scale);
+                dst += dst_pitch;
+            }
+        }
+    }
+
+
+    static void update_texture_rect_scaled(sdl::ScreenMemory& screen, Window const& window, Rect2Du32 r)
+    {
+        auto scale = screen.pixel_scale;
+
+        SDL_Rect rect{};
+        rect.x = (int)(r.x_begin * scale);
+        rect.y = (int)(r.y_begin * scale);
+        rect.w = (int)((r.x_end - r.x_begin) * scale);
+        rect.h = (int)((r.y_end - r.y_begin) * scale);
+
+        void* dst_data = 0;
+        int dst_pitch = 0;
+
+        if (!SDL_LockTexture(screen.texture, &rect, &dst_data, &dst_pitch))
+        {
+            sdl::print_error("SDL_LockTexture()");
+            return;
+        }
+
+        copy_window_pixels_scaled(window, r, scale, dst_data, dst_pitch);
+
+        SDL_UnlockTexture(screen.texture);
+    }
+
+
+    static void update_texture_rect(sdl::ScreenMemory& screen, Window const& window, Rect2Du32 r)
+    {
+        r.x_end = r.x_end < window.width_px ? r.x_end : window.width_px;
+        r.y_end = r.y_end < window.height_px ? r.y_end : window.height_px;
+
+        if (r.x_begin >= r.x_end || r.y_begin >= r.y_end)
+        {
+            return;
+        }
+
+        if (screen.pixel_scale > 1)
+        {
+            update_texture_rect_scaled(screen, window, r);
+            return;
+        }
+
+        SDL_Rect rect{};
+        rect.x = (int)r.x_begin;
+        rect.y = (int)r.y_begin;
+        rect.w = (int)(r.x_end - r.x_begin);
+        rect.h = (int)(r.y_end - r.y_begin);
+
+        auto pitch = (int)(window.width_px * sizeof(window.pixel_buffer[0]));
+        auto src = (void*)(window.pixel_buffer + (u64)r.y_begin * window.width_px + r.x_begin);
+
+        if (!SDL_UpdateTexture(screen.texture, &rect, src, pitch))
+        {
+            sdl::print_error("SDL_UpdateTexture()");
+        }
+    }
+
+
+    constexpr u32 HASH_TILE_SIZE = 64;
+
+
+    static u64 hash_tile(u32 const* src, u32 pitch, u32 width, u32 height)
+    {
+        // four independent multiply-xor lanes, two pixels per lane
+        constexpr u64 prime = 0x100000001B3;
+
+        u64 h[4] = { 0xCBF29CE484222325, 0x84222325CBF29CE4, 0x9E3779B97F4A7C15, 0x7F4A7C159E3779B9 };
+
+        for (u32 y = 0; y < height; y++)
+        {
+            auto row = src + (u64)y * pitch;
+
+            u32 x = 0;
+            for (; x + 8 <= width; x += 8)
+            {
+                for (u32 i = 0; i < 4; i++)
+                {
+                    u64 v = 0;
+                    SDL_memcpy(&v, row + x + 2 * i, sizeof(v));
+                    h[i] = (h[i] ^ v) * prime;
+                }
+            }
+
+            for (; x < width; x++)
+            {
+                h[0] = (h[0] ^ row[x]) * prime;
+            }
+        }
+
+        return h[0] ^ (h[1] >> 1) ^ (h[2] << 1) ^ (h[3] >> 3);
+    }
+
+
+    static bool update_tile_hashes(sdl::ScreenMemory& screen, Window const& window)
+    {
+        auto const n_x = (window.width_px + HASH_TILE_SIZE - 1) / HASH_TILE_SIZE;
+        auto const n_y = (window.height_px + HASH_TILE_SIZE - 1) / HASH_TILE_SIZE;
+
+        if (screen.tile_hashes && screen.n_tiles_x == n_x && screen.n_tiles_y == n_y)
+        {
+            return true;
+        }
+
+        if (screen.tile_hashes)
+        {
+            mem::free(screen.tile_hashes);
+            screen.tile_hashes = 0;
+        }
+
+        screen.n_tiles_x = 0;
+        screen.n_tiles_y = 0;
+        screen.tiles_valid = 0;
+
+        auto hashes = mem::alloc<u64>(n_x * n_y, "window.tile_hashes");
+        if (!hashes)
+        {
+            return false;
+        }
+
+        screen.tile_hashes = hashes;
+        screen.n_tiles_x = n_x;
+        screen.n_tiles_y = n_y;
+
+        return true;
+    }
+
+
+    static void update_texture_changed(sdl::ScreenMemory& screen, Window const& window)
+    {
+        if (!update_tile_hashes(screen, window))
+        {
+            update_texture_rect(screen, window, { 0, window.width_px, 0, window.height_px });
+            return;
+        }
+
+        constexpr u32 T = HASH_TILE_SIZE;
+
+        auto const w = window.width_px;
+        auto const h = window.height_px;
+
+        for (u32 ty = 0; ty < screen.n_tiles_y; ty++)
+        {
+            auto const y_begin = ty * T;
+            auto const y_end = y_begin + T < h ? y_begin + T : h;
+
+            auto hashes = screen.tile_hashes + (u64)ty * screen.n_tiles_x;
+
+            // changed tiles next to each other in a row are uploaded together
+            u32 run_begin = 0;
+            u32 run_length = 0;
+
+            for (u32 tx = 0; tx < screen.n_tiles_x; tx++)
+            {
+                auto const x_begin = tx * T;
+                auto const x_end = x_begin + T < w ? x_begin + T : w;
+
+                auto src = window.pixel_buffer + (u64)y_begin * w + x_begin;
+                auto hash = hash_tile(src, w, x_end - x_begin, y_end - y_begin);
+
+                if (screen.tiles_valid && hash == hashes[tx])
+                {
+                    if (run_length)
+                    {
+                        update_texture_rect(screen, window, { run_begin * T, tx * T, y_begin, y_end });
+                        run_length = 0;
+                    }
+
+                    continue;
+                }
+
+                hashes[tx] = hash;
+
+                if (!run_length)
+                {
+                    run_begin = tx;
+                }
+
+                run_length++;
+            }
+
+            if (run_length)
+            {
+                update_texture_rect(screen, window, { run_begin * T, w, y_begin, y_end });
+            }
+        }
+
+        screen.tiles_valid = 1;
+    }
+
+
+    static void present_texture(sdl::ScreenMemory& screen, b32 size_changed)
+    {
+        if (size_changed)
+        {
+            sdl::set_out_rect(screen);
+        }
+
+        SDL_SetRenderDrawColor(screen.renderer, 0, 0, 0, 255); // Black background
+        SDL_RenderClear(screen.renderer);
+
+        if (!SDL_RenderTexture(screen.renderer, screen.texture, NULL, &screen.render_rect))
+        {
+            sdl::print_error("SDL_RenderTexture()");
+        }
+
+        SDL_RenderPresent(screen.renderer);
+    }
 }
 
 
@@ -351,11 +698,13 @@ namespace window
     }
 
 
-    bool create(Window& window, cstr title, Vec2Du32 window_size, Vec2Du32 pixel_size)
+    bool create(Window& window, cstr title, Vec2Du32 window_size, Vec2Du32 pixel_size, u32 pixel_scale)
     {
+        SDL_assert(pixel_scale);
+
         SDL_zero(window);
         
-        if (!create_window_memory(window, title, window_size, pixel_size))
+        if (!create_window_memory(window, title, window_size, pixel_size, pixel_scale))
         {
             return false;
         }
@@ -371,16 +720,17 @@ namespace window
         }
 
         window.pixel_buffer = buffer;
-        window.width_px = screen.width_px;
-        window.height_px = screen.height_px;
+        window.width_px = pixel_size.x;
+        window.height_px = pixel_size.y;
+        window.pixel_scale = pixel_scale;
 
         return true;
     }
 
 
-    bool create(Window& window, cstr title, Vec2Du32 window_size, Vec2Du32 pixel_size, Icon64 const& icon)
+    bool create(Window& window, cstr title, Vec2Du32 window_size, Vec2Du32 pixel_size, u32 pixel_scale, Icon64 const& icon)
     {
-        if (!create(window, title, window_size, pixel_size))
+        if (!create(window, title, window_size, pixel_size, pixel_scale))
         {
             return false;
         }
@@ -392,20 +742,31 @@ namespace window
     }
 
 
-    bool create_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size)
+    bool create(Window& window, cstr title, Vec2Du32 window_size, Vec2Du32 pixel_size)
+    {
+        return create(window, title, window_size, pixel_size, 1);
+    }
+
+
+    bool create(Window& window, cstr title, Vec2Du32 window_size, Vec2Du32 pixel_size, Icon64 const& icon)
     {
+        return create(window, title, window_size, pixel_size, 1, icon);
+    }
+
+
+    bool create_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size, u32 pixel_scale)
+    {
+        SDL_assert(pixel_scale);
+
         SDL_zero(window);
         
-        if (!create_window_memory_fullscreen(window, title, pixel_size))
+        if (!create_window_memory_fullscreen(window, title, pixel_size, pixel_scale))
         {
             return false;
         }
 
         auto& screen = get_screen(window);
 
-        auto width = screen.width_px;
-        auto height = screen.height_px;
-
         auto buffer = mem::alloc<u32>(pixel_size.x * pixel_size.y, "window.pixel_buffer");
         if (!buffer)
         {
@@ -415,16 +776,17 @@ namespace window
         }
 
         window.pixel_buffer = buffer;
-        window.width_px = screen.width_px;
-        window.height_px = screen.height_px;
+        window.width_px = pixel_size.x;
+        window.height_px = pixel_size.y;
+        window.pixel_scale = pixel_scale;
 
         return true;
     }
 
 
-    bool create_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size, Icon64 const& icon)
+    bool create_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size, u32 pixel_scale, Icon64 const& icon)
     {
-        if (!create_fullscreen(window, title, pixel_size))
+        if (!create_fullscreen(window, title, pixel_size, pixel_scale))
         {
             return false;
         }
@@ -436,6 +798,18 @@ namespace window
     }
 
 
+    bool create_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size)
+    {
+        return create_fullscreen(window, title, pixel_size, 1);
+    }
+
+
+    bool create_fullscreen(Window& window, cstr title, Vec2Du32 pixel_size, Icon64 const& icon)
+    {
+        return create_fullscreen(window, title, pixel_size, 1, icon);
+    }
+
+
     void destroy(Window& window)
     {
         auto& screen = get_screen(window);
@@ -450,8 +824,9 @@ namespace window
     bool resize_pixel_buffer(Window& window, u32 width, u32 height)
     {
         auto& screen = get_screen(window);
+        auto scale = screen.pixel_scale;
 
-        if (width == screen.width_px && height == screen.height_px)
+        if (width == window.width_px && height == window.height_px)
         {
             return true;
         }
@@ -462,14 +837,16 @@ namespace window
             screen.texture = 0;
         }
 
-        if (!sdl::create_texture(screen, width, height))
+        if (!sdl::create_texture(screen, width * scale, height * scale))
         {
             return false;
         }
         
         auto n_pixels = width * height;
-        if (screen.width_px * screen.height_px == n_pixels)
-        {            
+        if (window.width_px * window.height_px == n_pixels)
+        {
+            window.width_px = width;
+            window.height_px = height;
             return true;
         }
 
@@ -486,8 +863,8 @@ namespace window
         }
 
         window.pixel_buffer = buffer;
-        window.width_px = screen.width_px;
-        window.height_px = screen.height_px;
+        window.width_px = width;
+        window.height_px = height;
 
         return true;
     }
@@ -496,6 +873,15 @@ namespace window
     void render(Window const& window, b32 size_changed)
     {
         auto& screen = get_screen(window);
+
+        if (screen.pixel_scale > 1)
+        {
+            // scaled straight into texture memory
+            update_texture_rect_scaled(screen, window, { 0, window.width_px, 0, window.height_px });
+            present_texture(screen, size_changed);
+            return;
+        }
+
         int err = 0;
 
         if (size_changed)
@@ -542,6 +928,71 @@ namespace window
     }
 
 
+    void render(Window const& window, Rect2Du32 const* dirty, u32 n_dirty, b32 size_changed)
+    {
+        auto& screen = get_screen(window);
+
+        for (u32 i = 0; i < n_dirty; i++)
+        {
+            update_texture_rect(screen, window, dirty[i]);
+        }
+
+        present_texture(screen, size_changed);
+    }
+
+
+    void render_changed(Window const& window, b32 size_changed)
+    {
+        auto& screen = get_screen(window);
+
+        update_texture_changed(screen, window);
+
+        present_texture(screen, size_changed);
+    }
+
+
+    bool lock_frame(Window const& window, FrameBuffer& frame)
+    {
+        static_assert(window::PIXEL_SIZE == sizeof(frame.pixel_data[0]));
+
+        auto& screen = get_screen(window);
+
+        SDL_zero(frame);
+
+        void* dst_data = 0;
+        int dst_pitch = 0;
+
+        if (!SDL_LockTexture(screen.texture, NULL, &dst_data, &dst_pitch))
+        {
+            sdl::print_error("SDL_LockTexture()");
+            return false;
+        }
+
+        screen.is_locked = 1;
+
+        frame.pixel_data = (u32*)dst_data;
+        frame.width_px = screen.width_px;
+        frame.height_px = screen.height_px;
+        frame.pitch_px = (u32)dst_pitch / window::PIXEL_SIZE;
+
+        return true;
+    }
+
+
+    void render_frame(Window const& window, b32 size_changed)
+    {
+        auto& screen = get_screen(window);
+
+        if (screen.is_locked)
+        {
+            SDL_UnlockTexture(screen.texture);
+            screen.is_locked = 0;
+        }
+
+        present_texture(screen, size_changed);
+    }
+
+
     void hide_mouse_cursor()
     {
         SDL_HideCursor();
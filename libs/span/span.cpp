@@ -0,0 +1,40 @@
+#pragma once
+
+#include "span.hpp"
+
+#include <cstring>
+
+// Plain C++ span primitives for tools built without SDL.
+
+
+/* api */
+
+namespace span
+{
+    void copy_u8(u8* src, u8* dst, u64 len_u8)
+    {
+        std::memcpy(dst, src, len_u8);
+    }
+
+
+    void copy_u8(u8* src, u8* dst1, u8* dst2, u64 len_u8)
+    {
+        std::memcpy(dst1, src, len_u8);
+        std::memcpy(dst2, src, len_u8);
+    }
+
+
+    void fill_u8(u8* dst, u8 value, u64 len_u8)
+    {
+        std::memset(dst, value, len_u8);
+    }
+
+
+    void fill_u32(u32* dst, u32 value, u64 len_u32)
+    {
+        for (u64 i = 0; i < len_u32; i++)
+        {
+            dst[i] = value;
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #define IMAGE_READ
+#define IMAGE_WRITE
 #include "../image/image.hpp"
+#include "../stb_libs/stb_image_write.h"
 
 #include <filesystem>
 #include <vector>
@@ -10,6 +12,7 @@
 #include <algorithm>
 #include <functional>
 #include <cassert>
+#include <bit>
 
 
 using ByteBuffer = MemoryBuffer<u8>;
@@ -196,6 +199,339 @@ namespace internal
 }
 
 
+/* atlas */
+
+namespace a2b
+{
+namespace internal
+{
+    class AtlasImage
+    {
+    public:
+        std::string name;
+        img::Image image;
+        Rect2Du32 rect;
+    };
+
+
+    class AtlasRect
+    {
+    public:
+        std::string name;
+        Rect2Du32 rect;
+    };
+
+
+    class AtlasRects
+    {
+    public:
+        std::string dir_name;
+
+        u32 width = 0;
+        u32 height = 0;
+
+        std::vector<AtlasRect> rects;
+    };
+
+
+    class SkylineNode
+    {
+    public:
+        u32 x;
+        u32 y;
+        u32 width;
+    };
+
+
+    // bottom-left skyline, images are placed in order
+    static bool pack_skyline(std::vector<AtlasImage>& items, u32 atlas_width, u32& atlas_height)
+    {
+        std::vector<SkylineNode> skyline;
+        skyline.push_back({ 0, 0, atlas_width });
+
+        atlas_height = 0;
+
+        for (auto& item : items)
+        {
+            auto const w = item.image.width;
+            auto const h = item.image.height;
+
+            if (w > atlas_width)
+            {
+                return false;
+            }
+
+            u32 best = 0;
+            u32 best_y = UINT32_MAX;
+
+            for (u32 i = 0; i < skyline.size() && skyline[i].x + w <= atlas_width; i++)
+            {
+                // highest node under [x, x + w)
+                u32 y = 0;
+                u32 covered = 0;
+                for (u32 j = i; covered < w; j++)
+                {
+                    y = std::max(y, skyline[j].y);
+                    covered += skyline[j].width;
+                }
+
+                if (y < best_y)
+                {
+                    best = i;
+                    best_y = y;
+                }
+            }
+
+            auto const x = skyline[best].x;
+            auto const x_end = x + w;
+
+            item.rect = { x, x_end, best_y, best_y + h };
+            atlas_height = std::max(atlas_height, best_y + h);
+
+            // the new node replaces the part of the skyline it covers
+            u32 i = best;
+            while (i < skyline.size() && skyline[i].x < x_end)
+            {
+                auto& node = skyline[i];
+                auto const node_end = node.x + node.width;
+
+                if (node_end <= x_end)
+                {
+                    skyline.erase(skyline.begin() + i);
+                    continue;
+                }
+
+                node.width = node_end - x_end;
+                node.x = x_end;
+                break;
+            }
+
+            skyline.insert(skyline.begin() + best, { x, best_y + h, w });
+
+            for (u32 k = 0; k + 1 < skyline.size();)
+            {
+                if (skyline[k].y == skyline[k + 1].y)
+                {
+                    skyline[k].width += skyline[k + 1].width;
+                    skyline.erase(skyline.begin() + k + 1);
+                }
+                else
+                {
+                    k++;
+                }
+            }
+        }
+
+        return true;
+    }
+
+
+    static u32 pack_atlas(std::vector<AtlasImage>& items, u32& atlas_height)
+    {
+        // tallest first, name breaks ties so the layout does not depend on directory order
+        std::sort(items.begin(), items.end(), [](auto const& a, auto const& b)
+        {
+            if (a.image.height != b.image.height)
+            {
+                return a.image.height > b.image.height;
+            }
+
+            if (a.image.width != b.image.width)
+            {
+                return a.image.width > b.image.width;
+            }
+
+            return a.name < b.name;
+        });
+
+        u32 max_width = 0;
+        u64 total_width = 0;
+        for (auto const& item : items)
+        {
+            max_width = std::max(max_width, item.image.width);
+            total_width += item.image.width;
+        }
+
+        // smallest area over power of two widths
+        u32 best_width = 0;
+        u64 best_area = UINT64_MAX;
+
+        u32 width = std::bit_ceil(max_width);
+        for (; ; width *= 2)
+        {
+            u32 height = 0;
+            pack_skyline(items, width, height);
+
+            if ((u64)width * height < best_area)
+            {
+                best_area = (u64)width * height;
+                best_width = width;
+            }
+
+            if (width >= total_width)
+            {
+                break;
+            }
+        }
+
+        pack_skyline(items, best_width, atlas_height);
+
+        return best_width;
+    }
+
+
+    static void append_png_bytes(void* context, void* data, int size)
+    {
+        auto& bytes = *(std::vector<u8>*)context;
+        auto src = (u8*)data;
+
+        bytes.insert(bytes.end(), src, src + size);
+    }
+
+
+    static std::vector<u8> encode_png(img::Image const& image)
+    {
+        std::vector<u8> bytes;
+
+        auto width = (int)image.width;
+        auto height = (int)image.height;
+        int channels = 4;
+
+        if (!stbi_write_png_to_func(append_png_bytes, &bytes, width, height, channels, image.data_, width * channels))
+        {
+            bytes.clear();
+        }
+
+        return bytes;
+    }
+
+
+    static bool read_atlas(fs::path const& dir, std::ofstream& bin, DirFiles& df, AtlasRects& ar)
+    {
+        std::vector<AtlasImage> items;
+
+        for (auto const& entry : fs::directory_iterator(dir))
+        {
+            auto p = entry.path();
+            if (!fs::is_regular_file(p))
+            {
+                continue;
+            }
+
+            AtlasImage item{};
+            item.name = p.stem().string();
+
+            if (!img::read_image_from_file(p.string().c_str(), item.image))
+            {
+                continue;
+            }
+
+            items.push_back(std::move(item));
+        }
+
+        if (items.empty())
+        {
+            return false;
+        }
+
+        u32 height = 0;
+        u32 width = pack_atlas(items, height);
+
+        img::Image atlas;
+        if (!img::create_image(atlas, width, height))
+        {
+            return false;
+        }
+
+        auto view = img::make_view(atlas);
+        img::fill(view, img::to_pixel(0, 0, 0, 0));
+
+        ar.dir_name = dir.filename().string();
+        ar.width = width;
+        ar.height = height;
+
+        for (auto& item : items)
+        {
+            img::copy(img::make_view(item.image), img::sub_view(view, item.rect));
+            img::destroy_image(item.image);
+
+            ar.rects.push_back({ item.name, item.rect });
+        }
+
+        auto bytes = encode_png(atlas);
+        img::destroy_image(atlas);
+
+        if (bytes.empty())
+        {
+            return false;
+        }
+
+        df.dir_name = ar.dir_name;
+        df.files.emplace_back("atlas", bytes.size());
+
+        bin.write((char*)bytes.data(), bytes.size());
+
+        return true;
+    }
+
+
+    static bool write_atlas_rects(std::vector<AtlasRects> const& data, fs::path const& dst_dir, std::string const& name)
+    {
+        auto tab = "    ";
+        auto tabtab = "        ";
+        std::ostringstream oss;
+
+        oss
+        << "const struct {\n\n";
+
+        for (auto const& item : data)
+        {
+            oss
+            << tab << "struct {\n"
+            << tabtab << "unsigned width; unsigned height;\n";
+
+            for (auto const& r : item.rects)
+            {
+                oss
+                << tabtab << "Rect2Du32 " << r.name << ";\n";
+            }
+
+            oss
+            << tab << "} " << item.dir_name << ";\n\n";
+        }
+
+        oss
+        << "}\n"
+        << name << " = \n"
+        << "{\n";
+
+        for (auto const& item : data)
+        {
+            oss
+            << tab << "{\n"
+            << tabtab << item.width << ", " << item.height << ",\n";
+
+            for (auto const& r : item.rects)
+            {
+                auto const& rect = r.rect;
+
+                oss
+                << tabtab << "{ " << rect.x_begin << ", " << rect.x_end << ", " << rect.y_begin << ", " << rect.y_end << " },\n";
+            }
+
+            oss
+            << tab << "},\n";
+        }
+
+        oss
+        << "};\n";
+
+        return internal::write_cpp_file(oss.str(), dst_dir, name);
+    }
+}
+}
+
+
 namespace a2b
 {
     class AssetFiles
@@ -203,6 +539,7 @@ namespace a2b
     public:
 
         std::vector<internal::DirFiles> file_sizes;
+        std::vector<internal::AtlasRects> atlas_rects;
         std::ofstream bin_file;
         fs::path out_dir;
     };
@@ -237,10 +574,45 @@ namespace a2b
     }
 
 
+    // all images in dir are packed into one png, the dir gets a single "atlas" entry
+    // sprite rects are written by save_and_close with a rect file name
+    inline bool append_atlas_dir(AssetFiles& af, fs::path const& dir)
+    {
+        if (!fs::is_directory(dir))
+        {
+            return false;
+        }
+
+        internal::DirFiles df;
+        internal::AtlasRects ar;
+
+        if (!internal::read_atlas(dir, af.bin_file, df, ar))
+        {
+            return false;
+        }
+
+        af.file_sizes.push_back(std::move(df));
+        af.atlas_rects.push_back(std::move(ar));
+
+        return true;
+    }
+
+
     inline bool save_and_close(AssetFiles& af, cstr size_file_name)
     {
         af.bin_file.close();
 
         return internal::write_file_sizes(af.file_sizes, af.out_dir, size_file_name);
     }
+
+
+    inline bool save_and_close(AssetFiles& af, cstr size_file_name, cstr rect_file_name)
+    {
+        if (!save_and_close(af, size_file_name))
+        {
+            return false;
+        }
+
+        return internal::write_atlas_rects(af.atlas_rects, af.out_dir, rect_file_name);
+    }
 }
\ No newline at end of file